@@ -1,21 +1,35 @@
 #include "headers/openGLdebug.hpp"
 #include "../include/GLFW/glfw3.h"
+#include <iostream>
+#include <memory>
+#include <random>
 #include <stdexcept>
 #include "headers/applicationClass.hpp"
 #include "headers/cellClass.hpp"
+#include "headers/computeSimulationClass.hpp"
+#include "headers/gpuSimulationClass.hpp"
+#include "core/headers/populationClass.hpp"
+#include "core/headers/simulationClockClass.hpp"
 #include "headers/timerClass.hpp"
 
 void Application::Init(GLuint glMajorVersion, GLuint glMinorVersion) {
     // Initalize GLFW
     glfwInit();
 
-    // Use CORE profile, version 3.3 of OpenGL
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // Use CORE profile, of the version asked for
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, glMajorVersion);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, glMinorVersion);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     // Create window
     this->window = glfwCreateWindow(this->width, this->height, "Cell cycle simulation", NULL, NULL);
+
+    // Fall back to version 3.3 of OpenGL, which everything but the compute backend needs
+    if (!window && (glMajorVersion > 3 || (glMajorVersion == 3 && glMinorVersion > 3))) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        this->window = glfwCreateWindow(this->width, this->height, "Cell cycle simulation", NULL, NULL);
+    }
     if (!window) {
         throw std::runtime_error("Failed to create window.");
     }
@@ -50,10 +64,43 @@ Application::~Application() {
     this->Terminate();
 }
 
-int Application::Run() {
-    Cells cells(20, 0.1);
-    
-    static float loopDurationSeconds = 0.0;
+// Run the viewer, stepping the cells with the backend asked for. On the GPU the cells do not
+// push each other apart. The compute backend falls back to the CPU when the context is older
+// than OpenGL 4.3. With analytic the CPU backend lets the cells overlap, and only updates and
+// uploads the cells with an event in each step
+int Application::Run(SimulationBackend backend, bool analytic) {
+    // Seed the population differently on each run and use every hardware thread
+    uint64_t seed = std::random_device()();
+    Population population(20, 0.1, seed, 0);
+
+    // Simulate in fixed steps of 1/60 seconds, at most 5 steps per frame
+    SimulationClock simulationClock(1.0 / 60.0, 5);
+    Cells cells(population, simulationClock.StepSeconds());
+
+    // Keep cells from overlapping so dense colonies stay readable, pushing changes every cell
+    // on every step so the analytic mode goes without it
+    if (analytic) {
+        population.EnableAnalyticMotion();
+        cells.EnableAnalyticMotion();
+    } else {
+        population.EnableMechanics(2.0, 0.03);
+    }
+
+    if (backend == computeBackend && !ComputeSimulation::Supported()) {
+        std::cerr << "Compute shaders need OpenGL 4.3, simulating on the CPU." << std::endl;
+        backend = cpuBackend;
+    }
+
+    // The GPU simulations start from the cells of the population
+    std::unique_ptr<GpuSimulation> gpu;
+    std::unique_ptr<ComputeSimulation> compute;
+    if (backend == transformFeedbackBackend) {
+        gpu.reset(new GpuSimulation(population, seed));
+    } else if (backend == computeBackend) {
+        compute.reset(new ComputeSimulation(population, seed));
+    }
+
+    static double loopDurationSeconds = 0.0;
 
     while (!glfwWindowShouldClose(this->window)) {
 
@@ -63,9 +110,32 @@ int Application::Run() {
         // Clear screen
         GLCALL(glClear(GL_COLOR_BUFFER_BIT));
 
-        // Update cells
-        cells.Update(loopDurationSeconds);
-        cells.UpdateBufferData();
+        // Update cells by whole steps of the simulation clock
+        unsigned int steps = simulationClock.Advance(loopDurationSeconds);
+        for (unsigned int i = 0; i < steps; ++i) {
+            if (gpu) {
+                gpu->Update(simulationClock.StepSeconds());
+            } else if (compute) {
+                compute->Update(simulationClock.StepSeconds());
+            } else {
+                population.Update(simulationClock.StepSeconds());
+
+                // Upload the records of the cells the step changed, before the next step forgets them
+                if (analytic) {
+                    cells.UpdateRecords();
+                }
+            }
+        }
+
+        // Draw the cells where they are part way into the next step
+        float aheadSeconds = simulationClock.Alpha() * simulationClock.StepSeconds();
+        if (gpu) {
+            cells.UpdateBufferData(gpu->StateBuffer(), gpu->Count(), aheadSeconds);
+        } else if (compute) {
+            cells.UpdateBufferDataIndirect(compute->StateBuffer(), compute->DrawBuffer(), aheadSeconds);
+        } else {
+            cells.UpdateBufferData(aheadSeconds);
+        }
 
         // Draw particles to screen
         cells.Draw();
@@ -75,8 +145,8 @@ int Application::Run() {
         glfwPollEvents();
  
         // End timer
-        long duration = clock.GetTime<std::chrono::milliseconds>();
-        loopDurationSeconds = (float)duration / 1000.0;
+        long duration = clock.GetTime<std::chrono::microseconds>();
+        loopDurationSeconds = (double)duration / 1000000.0;
     }
 
     return 0;
@@ -0,0 +1,264 @@
+#include "../core/headers/populationClass.hpp"
+#include "../core/headers/simdKernels.hpp"
+#include "../headers/timerClass.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Runs the population model without a window and reports throughput
+
+static void PrintUsage(const char* program) {
+	std::cerr << "Usage: " << program << " [--steps N | --seconds S] [--dt SECONDS] [--cells N] [--radius R] [--seed N] [--simd LEVEL] [--threads N] [--grid RADIUS] [--mechanics STIFFNESS] [--inhibition N] [--sort STEPS] [--check-sort] [--analytic] [--report STEPS]\n"
+		<< "  --steps N     Number of simulation steps to run (default 1000)\n"
+		<< "  --seconds S   Number of simulated seconds to run instead of a step count\n"
+		<< "  --dt SECONDS  Simulated seconds per step (default 1/60)\n"
+		<< "  --cells N     Initial number of cells (default 20)\n"
+		<< "  --radius R    Largest cell radius (default 0.1)\n"
+		<< "  --seed N      Seed of the random numbers, equal seeds give equal runs (default 1)\n"
+		<< "  --simd LEVEL  Limit the kernels to scalar, sse4, avx2 or avx512 (default widest supported)\n"
+		<< "  --threads N   Number of threads to update the cells on, 0 uses every hardware thread (default 0)\n"
+		<< "  --grid RADIUS Rebuild a spatial grid for neighbour queries up to RADIUS every step (default off)\n"
+		<< "  --mechanics STIFFNESS  Push overlapping cells apart with this stiffness (default off)\n"
+		<< "  --inhibition N Pause G1 cells touching more than N neighbours (default off)\n"
+		<< "  --sort STEPS   Sort the cells into Morton order every STEPS steps (default off)\n"
+		<< "  --check-sort   Run again without sorting and check every cell ends in the same state\n"
+		<< "  --analytic     Only update the cells with an event due, the others move on from their record (no grid, mechanics or inhibition)\n"
+		<< "  --report STEPS Print the simulated time and cell count every STEPS steps (default off)\n";
+}
+
+// FNV-1a hash of the cell state, equal runs give equal checksums. The radius is left
+// out, it follows from the other columns and is only kept while mechanics is on
+static uint64_t StateChecksum(const Population& population) {
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const void* data, size_t size) {
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+
+	// Columns are hashed block by block, which gives the same hash as one array
+	auto addColumn = [&add](const auto& column) {
+		for (unsigned int block = 0; block < column.block_count(); ++block) {
+			unsigned int count = std::min(column.size() - block * column.BLOCK_SIZE, column.BLOCK_SIZE);
+			add(column.block(block), count * sizeof(*column.block(block)));
+		}
+	};
+
+	addColumn(population.GetPosColumn(X));
+	addColumn(population.GetPosColumn(Y));
+	addColumn(population.GetVelColumn(X));
+	addColumn(population.GetVelColumn(Y));
+	addColumn(population.GetPhaseProgressColumn());
+	addColumn(population.GetPhaseColumn());
+	return hash;
+}
+
+// State of one cell, runs are compared cell by cell by ID as the order of the cells can differ
+struct CellState {
+	uint64_t id;
+	float x, y, vx, vy, phaseProgress, speedMultiplier;
+	uint8_t phase;
+
+	bool operator==(const CellState& other) const {
+		return id == other.id && x == other.x && y == other.y && vx == other.vx && vy == other.vy
+			&& phaseProgress == other.phaseProgress && speedMultiplier == other.speedMultiplier && phase == other.phase;
+	}
+};
+
+// State of every cell in ID order
+static std::vector<CellState> StatesById(const Population& population) {
+	std::vector<CellState> states(population.Count());
+	for (unsigned int i = 0; i < population.Count(); ++i) {
+		states[i] = {
+			population.GetIdColumn()[i],
+			population.GetPosColumn(X)[i], population.GetPosColumn(Y)[i],
+			population.GetVelColumn(X)[i], population.GetVelColumn(Y)[i],
+			population.GetPhaseProgressColumn()[i],
+			population.GetSpeedMultiplierColumn()[i], population.GetPhaseColumn()[i]
+		};
+	}
+	std::sort(states.begin(), states.end(), [](const CellState& a, const CellState& b) {
+		return a.id < b.id;
+	});
+	return states;
+}
+
+int main(int argc, char** argv) {
+	unsigned long steps = 1000;
+	float simulatedSeconds = 0.0;
+	float deltaSeconds = 1.0 / 60.0;
+	unsigned int cells = 20;
+	float radius = 0.1;
+	unsigned long long seed = 1;
+	unsigned int threads = 0;
+	float gridRadius = 0.0;
+	float stiffness = 0.0;
+	int inhibitionThreshold = -1;
+	unsigned int sortInterval = 0;
+	bool checkSort = false;
+	bool analytic = false;
+	unsigned long reportInterval = 0;
+
+	// Parse command line arguments
+	try {
+		for (int i = 1; i < argc; ++i) {
+			// Flags without a value
+			if (std::strcmp(argv[i], "--check-sort") == 0) {
+				checkSort = true;
+				continue;
+			}
+			if (std::strcmp(argv[i], "--analytic") == 0) {
+				analytic = true;
+				continue;
+			}
+
+			if (i + 1 >= argc) {
+				throw std::invalid_argument(argv[i]);
+			}
+
+			if (std::strcmp(argv[i], "--steps") == 0) {
+				steps = std::stoul(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--seconds") == 0) {
+				simulatedSeconds = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--dt") == 0) {
+				deltaSeconds = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--cells") == 0) {
+				cells = std::stoul(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--radius") == 0) {
+				radius = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--seed") == 0) {
+				seed = std::stoull(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--threads") == 0) {
+				threads = std::stoul(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--grid") == 0) {
+				gridRadius = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--mechanics") == 0) {
+				stiffness = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--inhibition") == 0) {
+				inhibitionThreshold = std::stoi(argv[++i]);
+				if (inhibitionThreshold < 0) {
+					throw std::invalid_argument("--inhibition");
+				}
+			}
+			else if (std::strcmp(argv[i], "--sort") == 0) {
+				sortInterval = std::stoul(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--report") == 0) {
+				reportInterval = std::stoul(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--simd") == 0) {
+				const char* name = argv[++i];
+				bool found = false;
+				for (int level = SimdKernels::scalar; level <= SimdKernels::avx512; ++level) {
+					if (std::strcmp(name, SimdKernels::LevelName((SimdKernels::Level)level)) == 0) {
+						SimdKernels::SetLevel((SimdKernels::Level)level);
+						found = true;
+					}
+				}
+				if (!found) {
+					throw std::invalid_argument(name);
+				}
+			}
+			else {
+				throw std::invalid_argument(argv[i]);
+			}
+		}
+
+		if (deltaSeconds <= 0.0) {
+			throw std::invalid_argument("--dt");
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Invalid argument: " << e.what() << "\n";
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	// A simulated duration overrides the step count
+	if (simulatedSeconds > 0.0) {
+		steps = (unsigned long)(simulatedSeconds / deltaSeconds + 0.5);
+	}
+
+	// Turn on the features asked for, every run of the population is set up the same way
+	auto configure = [&](Population& population, unsigned int sortInterval) {
+		population.EnableSpatialGrid(gridRadius);
+		population.EnableMechanics(stiffness, 0.3 * radius);
+		population.EnableMortonSort(sortInterval);
+
+		// Cells touch when their centres are closer than two of the largest radius
+		if (inhibitionThreshold >= 0) {
+			population.EnableContactInhibition(2.0 * radius, inhibitionThreshold);
+		}
+
+		// Turns the grid, mechanics and inhibition back off
+		if (analytic) {
+			population.EnableAnalyticMotion();
+		}
+	};
+
+	Population population(cells, radius, seed, threads);
+	configure(population, sortInterval);
+
+	// Run the model, counting how many cells were updated in total
+	unsigned long long cellSteps = 0;
+	Timer clock;
+	for (unsigned long i = 0; i < steps; ++i) {
+		cellSteps += population.Count();
+		population.Update(deltaSeconds);
+
+		// Show how the population grows, or levels off
+		if (reportInterval > 0 && (i + 1) % reportInterval == 0) {
+			std::cout << "step " << i + 1 << ", " << population.GetSimSeconds() << " s: " << population.Count() << " cells\n";
+		}
+	}
+	double wallSeconds = clock.GetTime<std::chrono::nanoseconds>() / 1e9;
+
+	// The analytic mode leaves most cells at their records, the state is compared where the cells are now
+	population.BringUpToDate();
+
+	// Report throughput
+	std::cout << "seed:              " << seed << "\n"
+		<< "threads:           " << population.ThreadCount() << "\n"
+		<< "simd:              " << SimdKernels::LevelName(SimdKernels::GetLevel()) << "\n"
+		<< "steps:             " << steps << "\n"
+		<< "simulated seconds: " << steps * deltaSeconds << "\n"
+		<< "final cells:       " << population.Count() << "\n"
+		<< "checksum:          " << std::hex << StateChecksum(population) << std::dec << "\n"
+		<< "wall time (s):     " << wallSeconds << "\n"
+		<< "steps/second:      " << (wallSeconds > 0.0 ? steps / wallSeconds : 0.0) << "\n"
+		<< "cells/second:      " << (wallSeconds > 0.0 ? cellSteps / wallSeconds : 0.0) << "\n";
+
+	// Sorting only moves cells in memory, so a run without it has to end with the same cells in the same state
+	if (checkSort) {
+		Population unsorted(cells, radius, seed, threads);
+		configure(unsorted, 0);
+		for (unsigned long i = 0; i < steps; ++i) {
+			unsorted.Update(deltaSeconds);
+		}
+		unsorted.BringUpToDate();
+
+		std::vector<CellState> sortedStates = StatesById(population);
+		std::vector<CellState> unsortedStates = StatesById(unsorted);
+		if (sortedStates != unsortedStates) {
+			std::cout << "sort check:        failed, " << unsorted.Count() << " cells without sorting\n";
+			return 1;
+		}
+		std::cout << "sort check:        passed\n";
+	}
+
+	return 0;
+}
@@ -1,443 +1,314 @@
 #include "../include/STB/stb_image.h"
+#include "core/headers/cellPhases.hpp"
 #include "headers/cellClass.hpp"
 #include "headers/openGLdebug.hpp"
 #include "headers/shaderClass.hpp"
+#include "headers/stateCacheClass.hpp"
 #include "srcDir.hpp"
 #include <GL/gl.h>
 #include <algorithm>
-#include <cmath>
-#include <cstdlib>
-#include <random>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
-
-namespace CellPhases {
-    const unsigned int count = 7;
-
-    enum Status: unsigned char {
-        g1, s, g2, // Interphase
-        pro, meta, ana, telo // Mitosis
-        // Note that cytokinesis happens instatly, this there is not status for it
-    };
-
-    // The Duration of each phase
-    static const float durationSeconds[count] = {
-        2.4, 2.1, 1.5,
-        1.0, 1.0, 1.0, 1.0,
-    };
-
-    // The radius at the start of each phase
-    static const float minRadius[count] = {
-        0.5, 0.9, 0.9,
-        1.0, 1.0, 1.0, 1.0
-    };
-
-    // The radius at the end of each phase
-    static const float maxRadius[count] = {
-        0.9, 0.9, 1.0,
-        1.0, 1.0, 1.0, 1.0
-    };
-}
-
-float& Cells::GetPos(unsigned int dimension, unsigned int index) {
-    return this->pos[index * 2 + dimension];
+// Records the record buffer has room for before the first growth
+const static GLuint INITIAL_RECORDS = 1024;
+
+// Copy the position, velocity, phase and progress of the cells at indices, or of the first count
+// cells when indices is null, into instances. Records also get the time the state was taken at
+static void CopyCells(const Population& population, const unsigned int* indices, unsigned int count, bool records, CellInstance* instances) {
+    const PagedColumn<float>& xPositions = population.GetPosColumn(X);
+    const PagedColumn<float>& yPositions = population.GetPosColumn(Y);
+    const PagedColumn<float>& xVelocities = population.GetVelColumn(X);
+    const PagedColumn<float>& yVelocities = population.GetVelColumn(Y);
+    const PagedColumn<uint8_t>& phases = population.GetPhaseColumn();
+    const PagedColumn<float>& phaseProgresses = population.GetPhaseProgressColumn();
+    const PagedColumn<float>& speedMultipliers = population.GetSpeedMultiplierColumn();
+
+    for (unsigned int k = 0; k < count; ++k) {
+        unsigned int i = indices ? indices[k] : k;
+        instances[k].x = xPositions[i];
+        instances[k].y = yPositions[i];
+        instances[k].vx = xVelocities[i];
+        instances[k].vy = yVelocities[i];
+        instances[k].phaseProgress = phaseProgresses[i];
+        instances[k].speedMultiplier = speedMultipliers[i];
+        instances[k].phase = phases[i];
+        instances[k].flags = 0;
+        instances[k].recordSeconds = records ? (float)population.GetRecordSeconds(i) : 0.0f;
+    }
 }
 
-float& Cells::GetVel(unsigned int dimension, unsigned int index) {
-    return this->vel[index * 2 + dimension];
+// Copy the position, velocity, phase and progress of each cell into its instance
+void Cells::CopyCellData(const Population& population, CellInstance* instances) {
+    CopyCells(population, nullptr, population.Count(), false, instances);
 }
 
-float& Cells::GetVerts(unsigned int dimension, unsigned int vertex, unsigned int index) {
-    size_t vertexSize = verts.size() / this->N / 4; // Number of floats per vertex
-    return this->verts[index * vertexSize * 4 + vertex * vertexSize + 2 + dimension];
+// View the buffer through the buffer texture
+void Cells::AttachInstances(GLuint buffer) {
+    // Each CellInstance is three texels, the floats are read back from their bits in the shader.
+    // glTexBuffer changes the texture bound on the active unit, and the bind is skipped when the
+    // texture is already bound, so the unit is made active as well
+    StateCache::BindTexture(1, GL_TEXTURE_BUFFER, this->instanceTexture);
+    StateCache::ActiveTexture(1);
+    GLCALL(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32UI, buffer));
 }
 
-const static unsigned int DECIMAL_PERCISION = 5;
-
 void Cells::Init() {
 
-    // Generate random particle positions, speed multipliers, and apoptosis resistance
-    this->pos.reserve(this->N * 2);
-    this->vel.reserve(this->N * 2);
-    for (int i = 0; i < this->N; ++i) {
-        std::uniform_int_distribution<int> uniformDistribution(-std::pow(10, DECIMAL_PERCISION), std::pow(10, DECIMAL_PERCISION));
-        std::random_device randomDevice;
-
-        // Randomly generate position in [-1, 1]
-        float xPos = uniformDistribution(randomDevice) / (float)std::pow(10, DECIMAL_PERCISION);
-        float yPos = uniformDistribution(randomDevice) / (float)std::pow(10, DECIMAL_PERCISION);
-
-        // Asign position
-        this->pos.push_back(xPos);
-        this->pos.push_back(yPos);
-
-        // Randomly generate velocity
-        float xVel = uniformDistribution(randomDevice) / (float)std::pow(10, DECIMAL_PERCISION) / 14.0;
-        float yVel = uniformDistribution(randomDevice) / (float)std::pow(10, DECIMAL_PERCISION) / 14.0;
+    // The vertex shader pulls the corners of the quads and the instance data itself, so the VAO
+    // has no attributes, but one still has to be bound to draw
+    GLCALL(glGenVertexArrays(1, &VAO));
 
-        // Asign velocity
-        this->vel.push_back(xVel);
-        this->vel.push_back(yVel);
+    // Buffer texture the vertex shader reads the instance data from, and the buffer of the records
+    GLCALL(glGenTextures(1, &instanceTexture));
+    GLCALL(glGenBuffers(1, &recordBuffer));
 
-        // Generate speed multiplier
-        this->speedMultiplier.push_back(1.0);
-        speedMultiplier[i] += uniformDistribution(randomDevice) / (float)std::pow(10, DECIMAL_PERCISION) * .2;
+    // Fill the uniform block of the phase tables, it never changes
+    PhaseTablesBlock phaseTables = {};
+    for (unsigned int i = 0; i < CellPhases::count; ++i) {
+        phaseTables.phases[i][0] = CellPhases::durationSeconds[i];
+        phaseTables.phases[i][1] = CellPhases::minRadius[i];
+        phaseTables.phases[i][2] = CellPhases::maxRadius[i];
     }
+    phaseTables.cellRadius = population.GetCellRadius();
+    phaseTables.radiusSpeedCap = CellPhases::radiusSpeedCap;
+    phaseTables.stepSeconds = this->stepSeconds;
+
+    GLCALL(glGenBuffers(1, &phaseTablesUBO));
+    GLCALL(glBindBuffer(GL_UNIFORM_BUFFER, phaseTablesUBO));
+    GLCALL(glBufferData(GL_UNIFORM_BUFFER, sizeof(phaseTables), &phaseTables, GL_STATIC_DRAW));
+    GLCALL(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+
+    GLCALL(glBindBufferBase(GL_UNIFORM_BUFFER, PHASE_TABLES_BINDING, phaseTablesUBO));
+    this->shaderProgram.BindUniformBlock("PhaseTables", PHASE_TABLES_BINDING);
+
+    // Load the image of each phase, and the ball image, into a layer of one texture array
+    // so the shader can pick the image of a cell with its phase
+    const char* imageFiles[CellPhases::count + 1] = {
+        "g1.png", "s.png", "g2.png", "pro.png", "meta.png", "ana.png", "telo.png", "ball.png"
+    };
+    std::string texturesPath = SOURCE_DIRECTORY + "/../textures/";
+    stbi_set_flip_vertically_on_load(true);
 
-    // x position in quad, y position in quad, particle position x, particle position y, particle position z
-    this->verts.reserve(5 * 4 * this->N);
-    for (int i = 0; i < this->N; ++i) {
-        std::uniform_int_distribution<unsigned int> uniformDistribution(1, 100);
-        std::random_device randomDevice;
-
-        CellPhases::Status phase;
-        using namespace CellPhases;
-
-        unsigned int randomNumber = uniformDistribution(randomDevice);
+    GLCALL(glGenTextures(1, &this->phaseTextures));
+    StateCache::BindTexture(0, GL_TEXTURE_2D_ARRAY, this->phaseTextures);
 
-        if (randomNumber <= 24) {
-            phase = g1;
-        }
-        else if (randomNumber <= 45) {
-            phase = s;
-        }
-        else if (randomNumber <= 60) {
-            phase = g2;
+    int layerWidth = 0, layerHeight = 0;
+    for (unsigned int i = 0; i < CellPhases::count + 1; ++i) {
+        // Load image as bytes, with 4 channels to match the texture format
+        int widthImg, heightImg, numCol;
+        unsigned char* imageBytes = stbi_load((texturesPath + imageFiles[i]).c_str(), &widthImg, &heightImg, &numCol, 4);
+        if (!imageBytes) {
+            throw std::runtime_error(stbi_failure_reason());
         }
-        else if (randomNumber <= 70) {
-            phase = pro;
-        }
-        else if (randomNumber <= 80) {
-            phase = meta;
-        }
-        else if (randomNumber <= 90) {
-            phase = ana;
+
+        // Every layer of the array has the size of the first image
+        if (i == 0) {
+            layerWidth = widthImg;
+            layerHeight = heightImg;
+            GLCALL(glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layerWidth, layerHeight, CellPhases::count + 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
         }
-        else {
-            phase = telo;
+        else if (widthImg != layerWidth || heightImg != layerHeight) {
+            stbi_image_free(imageBytes);
+            throw std::runtime_error(std::string("Texture ") + imageFiles[i] + " does not have the size of the other textures.");
         }
 
-        std::vector<GLfloat> quad = {
-            -1.0,  1.0, this->GetPos(X, i), this->GetPos(Y, i), this->r, (float)phase,
-            1.0,  1.0, this->GetPos(X, i), this->GetPos(Y, i), this->r, (float)phase,
-            1.0, -1.0, this->GetPos(X, i), this->GetPos(Y, i), this->r, (float)phase,
-            -1.0, -1.0, this->GetPos(X, i), this->GetPos(Y, i), this->r, (float)phase,
-        };
-        verts.insert(verts.end(), quad.begin(), quad.end());
-    };
-
-    // Calculate indices for index buffer
-    indices.reserve(3 * 2 * this->N);
-    for (unsigned int i = 0; i < this->N; ++i) {
-        GLuint offset = i * 4;
-        std::vector<GLuint> quad_vertices = {
-            offset, offset + 1, offset + 2,
-            offset, offset + 2, offset + 3,
-        };
-        indices.insert(indices.end(), quad_vertices.begin(), quad_vertices.end());
-    }
-
-    // Generate buffers
-    GLCALL(glGenVertexArrays(1, &VAO));
-    GLCALL(glGenBuffers(1, &VBO));
-    GLCALL(glGenBuffers(1, &EBO));
-
-    // Bind VAO
-    GLCALL(glBindVertexArray(VAO));
-
-    // Bind VBO
-    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, VBO));
-
-    // Fill VBO with vertex data
-    GLCALL(glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * verts.size(), verts.data(), GL_STATIC_DRAW));
-
-    // Number of floats per vertex
-    size_t vertexSize = verts.size() / this->N / 4;
-
-    // Tell OpenGL how the vertex data in VBO is layed out
-    GLCALL(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, vertexSize * sizeof(GLfloat), (void*)0));
-    GLCALL(glEnableVertexAttribArray(0));
-
-    GLCALL(glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, vertexSize * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat))));
-    GLCALL(glEnableVertexAttribArray(1));
-
-    GLCALL(glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, vertexSize * sizeof(GLfloat), (void*)(4 * sizeof(GLfloat))));
-    GLCALL(glEnableVertexAttribArray(2));
-
-    GLCALL(glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, vertexSize * sizeof(GLfloat), (void*)(5 * sizeof(GLfloat))));
-    GLCALL(glEnableVertexAttribArray(3));
-
-    // Bind index buffer bbject for vertices
-    GLCALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO));
-
-    // Fill Index Buffer Object with vertex data
-    GLCALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_STATIC_DRAW));
-
-    // Unbind buffers
-    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
-    GLCALL(glBindVertexArray(0));
-    GLCALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-
-    // Load images as bytes
-    int widthImg, heightImg, numCol;
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char* imageBytes[8];
-
-    std::string texturesPath = SOURCE_DIRECTORY + "/../textures/";
-    {
-        using namespace CellPhases;
-
-        # define STBILOG(x)\
-        x;\
-        if (stbi_failure_reason()) throw std::runtime_error(stbi_failure_reason());
-
-        STBILOG(imageBytes[g1] = stbi_load(std::string(texturesPath + "g1.png").c_str(), &widthImg, &heightImg, &numCol, 0));
-        STBILOG(imageBytes[s] = stbi_load(std::string(texturesPath + "s.png").c_str(), &widthImg, &heightImg, &numCol, 0));
-        STBILOG(imageBytes[g2] = stbi_load(std::string(texturesPath + "g2.png").c_str(), &widthImg, &heightImg, &numCol, 0));
-        STBILOG(imageBytes[pro] = stbi_load(std::string(texturesPath + "pro.png").c_str(), &widthImg, &heightImg, &numCol, 0));
-        STBILOG(imageBytes[meta] = stbi_load(std::string(texturesPath + "meta.png").c_str(), &widthImg, &heightImg, &numCol, 0));
-        STBILOG(imageBytes[ana] = stbi_load(std::string(texturesPath + "ana.png").c_str(), &widthImg, &heightImg, &numCol, 0));
-        STBILOG(imageBytes[telo] = stbi_load(std::string(texturesPath + "telo.png").c_str(), &widthImg, &heightImg, &numCol, 0));
-        STBILOG(imageBytes[7] = stbi_load(std::string(texturesPath + "ball.png").c_str(), &widthImg, &heightImg, &numCol, 0));
+        // Load image into its layer and free memory
+        GLCALL(glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, layerWidth, layerHeight, 1, GL_RGBA, GL_UNSIGNED_BYTE, imageBytes));
+        stbi_image_free(imageBytes);
     }
 
-    // Create textures
-    for (int i = 0; i < CellPhases::count + 1; ++i) {
-        GLCALL(glGenTextures(1, &this->texture[i]));
-        GLCALL(glActiveTexture(GL_TEXTURE0 + i));
-        GLCALL(glBindTexture(GL_TEXTURE_2D, this->texture[i]));
-
-        // Texture settings
-        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
-        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    // Texture settings
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
 
-        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
-        GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT));
+    GLCALL(glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT));
 
-        // Load image into texture
-        GLCALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, widthImg, heightImg, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageBytes[i]));
-
-        // Generate mini textures
-        GLCALL(glGenerateMipmap(GL_TEXTURE_2D));
-
-        // Free memory and unbind texture
-        stbi_image_free(imageBytes[i]);
-    }
+    // Generate mini textures
+    GLCALL(glGenerateMipmap(GL_TEXTURE_2D_ARRAY));
 
-    GLCALL(glBindTexture(GL_TEXTURE_2D, 0));
+    StateCache::BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
 
-    // Asign duration of each stage at random point
-    this->statusDurationSeconds.reserve(this->N);
-    for (int i = 0; i < this->N; ++i) {
-        std::uniform_int_distribution<unsigned int> uniformDistribution(0, std::pow(10, DECIMAL_PERCISION));
-        std::random_device randomDevice;
-
-        float duration = uniformDistribution(randomDevice) / (float)std::pow(10, DECIMAL_PERCISION) * CellPhases::durationSeconds[(int)this->GetVerts(S, 0, i)];
-        statusDurationSeconds.push_back(duration);
-    }
+    // Copy the cell data into the instance buffer
+    this->UpdateBufferData(0.0);
 }
 
 void Cells::Draw() {
     // Activate shader program
     this->shaderProgram.Activate();
 
-    // Bind texture
-    GLCALL(glBindTexture(GL_TEXTURE_2D, this->texture[0]));
+    // Bind textures, the cache skips the binds and the uniforms when they have not changed
+    StateCache::BindTexture(0, GL_TEXTURE_2D_ARRAY, this->phaseTextures);
+    StateCache::BindTexture(1, GL_TEXTURE_BUFFER, this->instanceTexture);
+    this->phaseTexturesUniform.Set(0);
+    this->instancesUniform.Set(1);
 
-    // Texture uniform
-    const char* uniformNames[7] = {
-        "g1Texture", "sTexture", "g2Texture",
-        "proTexture", "metaTexture", "anaTexture", "teloTexture"
-    };
+    // First texel of the instance data, and the time to draw the cells at
+    this->instanceBaseUniform.Set(this->instanceBase);
+    this->drawSecondsUniform.Set(this->drawSeconds);
 
-    for (int i = 0; i < CellPhases::count; ++i) {
-        GLuint textureLoc;
-        GLCALL(textureLoc = glGetUniformLocation(this->shaderProgram.ID, uniformNames[i]));
-        GLCALL(glUniform1i(textureLoc, i));
+    // Draw two triangles for every cell, the vertex shader finds the cell and corner from the vertex ID
+    GLCALL(glBindVertexArray(VAO));
+    if (this->drawBuffer) {
+        GLCALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->drawBuffer));
+        GLCALL(glDrawArraysIndirect(GL_TRIANGLES, nullptr));
+        GLCALL(glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+    } else {
+        GLCALL(glDrawArrays(GL_TRIANGLES, 0, 6 * this->N));
     }
 
-    // Draw triangles
-    GLCALL(glBindVertexArray(VAO));
-    GLCALL(glDrawElements(GL_TRIANGLES, 6 * this->N, GL_UNSIGNED_INT, 0));
+    // The instance data can be written over once the GPU has drawn it
+    this->instanceStream.Fence();
 }
 
-void Cells::Update(float deltaSeconds) {
-
-    this->duplicationOcured = false;
-
-    // Update cell cycle
-    for (int i = 0; i < this->N; ++i) {
-
-        // Update the amount of time in the current phase
-        this->statusDurationSeconds[i] += deltaSeconds * this->speedMultiplier[i];
-
-        // Get the current stage of the cell (as an integer for ease of use)
-        int currentStage = this->GetVerts(S, 0, i);
-
-        // Check if the cell has been in the current phase for the full time it should
-        if (this->statusDurationSeconds[i] >= CellPhases::durationSeconds[currentStage]) {
+// Draw the cells from a record of each cell. A record is only written again when a step changes
+// the cell other than by moving it along its velocity and through its phases, which the vertex
+// shader works out from the time of the record. Steps without pushing, pausing or sorting only
+// change the cells with an event, so only those are uploaded. A population in its analytic mode
+// keeps the records itself, and only touches those cells at all
+void Cells::EnableAnalyticMotion() {
+    this->analytic = true;
+}
 
-            // Move the cell to the next stage
-            bool cellShouldDuplicate = false;
-            for (int j = 0; j < 4; j++) {
-                this->GetVerts(S, j, i) += 1;
+// Bring the records up to the last step of the population. Called after every step only the cells
+// the step changed are uploaded, when a step was missed every record is uploaded again
+void Cells::UpdateRecords() {
+    uint32_t step = this->population.GetStep();
+    if (this->recordsUploaded && step == this->recordStep) {
+        return;
+    }
+    unsigned int count = this->population.Count();
+    bool everything = !this->recordsUploaded || step != this->recordStep + 1 || this->population.AllCellsChanged();
+
+    // A larger buffer starts empty, so every record is written to it
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, this->recordBuffer));
+    if (count > this->recordCapacity) {
+        this->recordCapacity = std::max(2 * count, INITIAL_RECORDS);
+        GLCALL(glBufferData(GL_ARRAY_BUFFER, this->recordCapacity * sizeof(CellInstance), nullptr, GL_DYNAMIC_DRAW));
+        everything = true;
+    }
 
-                // Wrap the cell back to g1-phase if it has completed the cycle
-                if (cellShouldDuplicate || this->GetVerts(S, j, i) >= CellPhases::count) {
-                    cellShouldDuplicate = true;
-                    this->GetVerts(S, j, i) = CellPhases::Status::g1;
-                }
+    if (everything) {
+        this->records.resize(count);
+        CopyCells(this->population, nullptr, count, true, this->records.data());
+        GLCALL(glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(CellInstance), this->records.data()));
+    }
+    else {
+        // Cells past the last one died later in the step
+        this->changedRecords.clear();
+        for (unsigned int i : this->population.GetChangedCells()) {
+            if (i < count) {
+                this->changedRecords.push_back(i);
             }
-
-            if (cellShouldDuplicate) {
-
-                // Duplicate the position
-                this->pos.push_back(this->GetPos(X, i));
-                this->pos.push_back(this->GetPos(Y, i));
-
-                // Duplicate and flip the velocity
-                this->vel.push_back(this->GetVel(X, i) * -1);
-                this->vel.push_back(this->GetVel(Y, i) * -1);
-
-                // Duplicate the status duration
-                this->statusDurationSeconds.push_back(0.0);
-
-                // Number of floats in each vertex
-                unsigned int quadSize = this->verts.size() / this->N;
-
-                // Duplicate the quad
-                this->verts.insert(verts.end(), verts.begin() + quadSize * i, verts.begin() + quadSize * (i + 1));
-
-                // Create new index buffer
-                unsigned int offset = 4 * this->N;
-
-                // Create new index buffer section
-                std::vector<GLuint> index = {
-                    offset + 0, offset + 1, offset + 2,
-                    offset + 0, offset + 2, offset + 3,
-                };
-                this->indices.insert(indices.end(), index.begin(), index.end());
-
-                // Modify the speedMultiplier values
-                std::uniform_int_distribution<int> uniformDistribution((int)(-0.5 * std::pow(10, DECIMAL_PERCISION)), std::pow(10, DECIMAL_PERCISION));
-                std::random_device randomDevice;
-
-                float speedMultiplierMultiplier = 1.0 + uniformDistribution(randomDevice) / (float)std::pow(10, DECIMAL_PERCISION) * .5;
-                this->speedMultiplier.push_back(speedMultiplier[i] * speedMultiplierMultiplier);
-
-                speedMultiplierMultiplier = 1.0 + uniformDistribution(randomDevice) / (float)std::pow(10, DECIMAL_PERCISION) * .5;
-                this->speedMultiplier[i] *= speedMultiplierMultiplier;
-
-
-                // Increase the number of cells by 1 and mark that a cell has been duplicated
-                this->N += 1;
-                this->duplicationOcured = true;
+        }
+        std::sort(this->changedRecords.begin(), this->changedRecords.end());
+        this->changedRecords.erase(std::unique(this->changedRecords.begin(), this->changedRecords.end()), this->changedRecords.end());
+
+        unsigned int changedCount = this->changedRecords.size();
+        this->records.resize(changedCount);
+        CopyCells(this->population, this->changedRecords.data(), changedCount, true, this->records.data());
+
+        // Upload each run of neighbouring records in one go, the daughters are all at the end
+        unsigned int first = 0;
+        while (first < changedCount) {
+            unsigned int last = first + 1;
+            while (last < changedCount && this->changedRecords[last] == this->changedRecords[last - 1] + 1) {
+                ++last;
             }
-
-            // Reset the duration for the current stage
-            this->statusDurationSeconds[i] = 0.0;
+            GLCALL(glBufferSubData(GL_ARRAY_BUFFER, this->changedRecords[first] * sizeof(CellInstance), (last - first) * sizeof(CellInstance), this->records.data() + first));
+            first = last;
         }
     }
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
 
-    // Update the radius of the cells
-    for (int i = 0; i < this->N; ++i) {
-
-        // Get the current stage (as an integer)
-        int currentStage = this->GetVerts(S, 0, i);
-
-        // Calculate what percent through the cell cycle we are
-        float progressPercent = this->statusDurationSeconds[i] / CellPhases::durationSeconds[currentStage];
-
-        // Calcuate what the radius should be based on the progress percentage
-        using namespace CellPhases;
-        float radius = minRadius[currentStage] + (maxRadius[currentStage] - minRadius[currentStage]) * progressPercent;
-        radius *= this->r / std::min(speedMultiplier[i], 3.0f);
+    this->N = count;
+    this->recordStep = step;
+    this->recordsUploaded = true;
+}
 
-        // Update radius of cell
-        for (int j = 0; j < 4; j++) {
-            this->GetVerts(R, j, i) = radius;
-        }
+// Draw the cells aheadSeconds past the current state of the population. The vertex shader
+// moves the cells along their velocities, so the cells are only uploaded after the population steps
+void Cells::UpdateBufferData(float aheadSeconds) {
+    this->drawBuffer = 0;
+    if (this->analytic) {
+        this->UpdateRecords();
+        this->drawSeconds = (float)(this->population.GetSimSeconds() + aheadSeconds);
+
+        // The record buffer is replaced when it grows, so the texture is pointed at it on every call
+        this->AttachInstances(this->recordBuffer);
+        this->attachedGeneration = 0;
+        this->instanceBase = 0;
+        this->uploadedSeconds = -1.0;
+        return;
     }
 
-    // Check bounds
-    for (int i = 0; i < this->N; ++i) {
-
-        if (this->GetPos(X, i) >= 1.0) {
-            this->GetVel(X, i) *= -1.0;
-            this->GetPos(X, i) -= this->GetPos(X, i) - 1.0;
-        }
-
-        if (this->GetPos(X, i) <= -1.0) {
-            this->GetVel(X, i) *= -1.0;
-            this->GetPos(X, i) -= this->GetPos(X, i) + 1.0;
-        }
-
-        if (this->GetPos(Y, i) >= 1.0) {
-            this->GetVel(Y, i) *= -1.0;
-            this->GetPos(Y, i) -= this->GetPos(Y, i) - 1.0;
-        }
-
-        if (this->GetPos(Y, i) <= -1.0) {
-            this->GetVel(Y, i) *= -1.0;
-            this->GetPos(Y, i) -= this->GetPos(Y, i) + 1.0;
-        }
+    this->drawSeconds = aheadSeconds;
+    if (population.GetSimSeconds() == this->uploadedSeconds) {
+        return;
     }
-
-    // Update cells positon based on velocity
-    for (int i = 0; i < this->N; ++i) {
-        this->pos[i * 2] += this->vel[i * 2] * deltaSeconds;
-        this->pos[i * 2 + 1] += this->vel[i * 2 + 1] * deltaSeconds;
+    this->uploadedSeconds = population.GetSimSeconds();
+    this->N = this->population.Count();
+
+    // Write the cell state straight into the part of the instance buffer the GPU is not reading
+    CellInstance* instances = (CellInstance*)this->instanceStream.Map(this->N * sizeof(CellInstance));
+    CopyCellData(this->population, instances);
+    GLintptr offset = this->instanceStream.Unmap();
+
+    // The stream replaces its buffer when it grows, the new one can reuse the old name so
+    // the generation tells when the texture has to be pointed at the new storage
+    if (this->instanceStream.Generation() != this->attachedGeneration) {
+        this->AttachInstances(this->instanceStream.Buffer());
+        this->attachedGeneration = this->instanceStream.Generation();
     }
 
-    // Update vertex data with new position
-    for (int i = 0; i < this->N; ++i) {
-        this->GetVerts(X, 0, i) = this->GetPos(X, i);
-        this->GetVerts(X, 1, i) = this->GetPos(X, i);
-        this->GetVerts(X, 2, i) = this->GetPos(X, i);
-        this->GetVerts(X, 3, i) = this->GetPos(X, i);
-        
-        this->GetVerts(Y, 0, i) = this->GetPos(Y, i);
-        this->GetVerts(Y, 1, i) = this->GetPos(Y, i);
-        this->GetVerts(Y, 2, i) = this->GetPos(Y, i);
-        this->GetVerts(Y, 3, i) = this->GetPos(Y, i);
-    }
+    // Every region of the stream is a whole number of texels
+    this->instanceBase = offset / (4 * sizeof(GLuint));
 }
 
+// Draw the cells of a state buffer kept on the GPU, laid out as CellInstance, aheadSeconds past its state
+void Cells::UpdateBufferData(GLuint stateBuffer, GLuint count, float aheadSeconds) {
+    this->drawSeconds = aheadSeconds;
+    this->N = count;
+    this->drawBuffer = 0;
 
-void Cells::UpdateBufferData() {
-    // Bind Vertex Buffer
-    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, this->VBO));
+    // The simulations swap and replace their buffers, so the texture is pointed at the buffer on every call
+    this->AttachInstances(stateBuffer);
+    this->attachedGeneration = 0;
+    this->instanceBase = 0;
 
-    // Fill vertex buffer with new data
-
-    // If no dupliction occured then sub data, other wise more space needs to be allocated
-    if (!duplicationOcured) {
-        GLCALL(glBufferSubData(GL_ARRAY_BUFFER, 0, verts.size() * sizeof(GLfloat), verts.data()));
-    } else {
-        GLCALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, verts.size() * sizeof(GLuint), indices.data(), GL_DYNAMIC_DRAW));
-        GLCALL(glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(GLfloat), verts.data(), GL_DYNAMIC_DRAW));
-    }
+    // The population is uploaded again if it is drawn next
+    this->uploadedSeconds = -1.0;
+    this->recordsUploaded = false;
+}
 
-    // Unbind Vertex Buffer
-    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+// Draw the cells of a state buffer kept on the GPU whose number is only known on the GPU, drawBuffer
+// holds the command for glDrawArraysIndirect at offset 0. Needs OpenGL 4.0
+void Cells::UpdateBufferDataIndirect(GLuint stateBuffer, GLuint drawBuffer, float aheadSeconds) {
+    this->UpdateBufferData(stateBuffer, 0, aheadSeconds);
+    this->drawBuffer = drawBuffer;
 }
 
 const static std::string vertexFilePath = SOURCE_DIRECTORY + "/shaders/cell.vert.glsl";
 const static std::string fragmentFilePath = SOURCE_DIRECTORY + "/shaders/cell.frag.glsl";
 
-Cells::Cells(GLuint N, GLfloat r) : N(N), r(r), shaderProgram(vertexFilePath.c_str(), fragmentFilePath.c_str()) {
+Cells::Cells(const Population& population, float stepSeconds) : N(0), drawBuffer(0), population(population), shaderProgram(vertexFilePath.c_str(), fragmentFilePath.c_str()),
+  phaseTexturesUniform(shaderProgram.GetUniform<GLint>("phaseTextures")), instancesUniform(shaderProgram.GetUniform<GLint>("instances")),
+  instanceBaseUniform(shaderProgram.GetUniform<GLint>("instanceBase")), drawSecondsUniform(shaderProgram.GetUniform<GLfloat>("drawSeconds")),
+  attachedGeneration(0), instanceBase(0), uploadedSeconds(-1.0), drawSeconds(0.0f), stepSeconds(stepSeconds), analytic(false), recordBuffer(0),
+  recordCapacity(0), recordsUploaded(false), recordStep(0), changedRecords(), records() {
     this->Init();
 }
 
 void Cells::Terminate() {
     GLCALL(glDeleteVertexArrays(1, &this->VAO));
-    GLCALL(glDeleteBuffers(1, &this->VBO));
-    GLCALL(glDeleteBuffers(1, &this->EBO));
-    for (int i = 0; i < CellPhases::count; ++i) {
-        GLCALL(glDeleteTextures(1, &this->texture[i]));
-    }
+    GLCALL(glDeleteBuffers(1, &this->phaseTablesUBO));
+    GLCALL(glDeleteBuffers(1, &this->recordBuffer));
+    StateCache::ForgetTexture(this->instanceTexture);
+    GLCALL(glDeleteTextures(1, &this->instanceTexture));
+    StateCache::ForgetTexture(this->phaseTextures);
+    GLCALL(glDeleteTextures(1, &this->phaseTextures));
 }
 
 Cells::~Cells() {
@@ -0,0 +1,322 @@
+#include "headers/computeSimulationClass.hpp"
+#include "headers/cellClass.hpp"
+#include "headers/openGLdebug.hpp"
+#include "core/headers/cellPhases.hpp"
+#include "srcDir.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Cells the buffers have room for before the first growth
+const static GLuint INITIAL_CAPACITY = 1024;
+
+// Layout of the arguments buffer, as the Arguments block of the shaders: the draw command, the
+// cell count, one unused value and the next ID, then the values and the work groups of each level
+// of the prefix sum. Capacities fit in 32 bits, so the prefix sum never has more than 4 levels
+const static GLintptr CELL_COUNT_OFFSET = 4 * sizeof(GLuint);
+const static GLintptr NEXT_ID_OFFSET = 6 * sizeof(GLuint);
+const static GLintptr LEVELS_OFFSET = 8 * sizeof(GLuint);
+const static GLuint MAX_LEVELS = 4;
+const static GLsizeiptr ARGUMENTS_SIZE = LEVELS_OFFSET + MAX_LEVELS * 4 * sizeof(GLuint);
+
+// Nanoseconds each wait for a fence lasts before it is checked again
+const static GLuint64 WAIT_NANOSECONDS = 1000000;
+
+// Number of work groups needed for count threads
+static GLuint GroupCount(GLuint count) {
+    return (count + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE;
+}
+
+// Give every buffer room for capacity cells, the cells of the current state are kept. Only the
+// GPU knows how many cells there are, so the whole of the old buffer is copied
+void ComputeSimulation::Allocate(GLuint capacity) {
+    GLuint buffers[2];
+    GLCALL(glGenBuffers(2, buffers));
+    for (GLuint buffer : buffers) {
+        GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+        GLCALL(glBufferData(GL_COPY_WRITE_BUFFER, capacity * sizeof(CellInstance), nullptr, GL_DYNAMIC_COPY));
+    }
+
+    // Copy the current state on the GPU, it never goes through the CPU
+    if (this->capacity > 0) {
+        GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, this->stateBuffers[this->current]));
+        GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[this->current]));
+        GLCALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, this->capacity * sizeof(CellInstance)));
+        GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    }
+    GLCALL(glDeleteBuffers(2, this->stateBuffers));
+    std::copy(buffers, buffers + 2, this->stateBuffers);
+
+    // The flags and offsets only hold values during a step
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, this->flagsBuffer));
+    GLCALL(glBufferData(GL_COPY_WRITE_BUFFER, capacity * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY));
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, this->offsetsBuffer));
+    GLCALL(glBufferData(GL_COPY_WRITE_BUFFER, capacity * 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY));
+
+    // One level of group totals for each time the prefix sum has more than one group
+    GLCALL(glDeleteBuffers(this->sumBuffers.size(), this->sumBuffers.data()));
+    this->sumBuffers.clear();
+    GLuint groups = capacity;
+    do {
+        groups = GroupCount(groups);
+        GLuint buffer;
+        GLCALL(glGenBuffers(1, &buffer));
+        GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+        GLCALL(glBufferData(GL_COPY_WRITE_BUFFER, groups * 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY));
+        this->sumBuffers.push_back(buffer);
+    } while (groups > 1);
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+    this->capacity = capacity;
+}
+
+// Run the active program with a thread for each value of a level of the prefix sum, the first level
+// has a value for each cell. The GPU wrote the work groups into the arguments at the end of the last step
+void ComputeSimulation::Dispatch(unsigned int level) {
+    GLCALL(glDispatchComputeIndirect(LEVELS_OFFSET + (4 * level + 1) * sizeof(GLuint)));
+}
+
+// Exclusive prefix sum of the count pairs in buffer. Each work group scans its own
+// values, then the group totals are scanned at the next level and added back. Every
+// level the capacity needs is run, the levels past the cells scan a single group
+void ComputeSimulation::Scan(GLuint buffer, unsigned int level) {
+    this->scanProgram.Activate();
+    this->scanLevelUniform.Set(level);
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer));
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->sumBuffers[level]));
+    this->Dispatch(level);
+    GLCALL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+
+    if (level + 1 < this->sumBuffers.size()) {
+        this->Scan(this->sumBuffers[level], level + 1);
+
+        this->scanAddProgram.Activate();
+        this->scanAddLevelUniform.Set(level);
+        GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer));
+        GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->sumBuffers[level]));
+        this->Dispatch(level);
+        GLCALL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+    }
+}
+
+// Fold the totals of the last step into the arguments and size the next step and the draw
+// from the new cell count, on the GPU
+void ComputeSimulation::WriteArguments() {
+    this->argumentsProgram.Activate();
+    this->levelCountUniform.Set((GLuint)this->sumBuffers.size());
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, this->totalsBuffer));
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, this->argumentsBuffer));
+    GLCALL(glDispatchCompute(1, 1, 1));
+
+    // The arguments are read by the shaders, the dispatches, the draw and the copy of the count
+    GLCALL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT));
+}
+
+// Read the counts of the waiting steps the GPU has finished, the oldest first. With wait the
+// oldest step is waited for, the others are only read if they are already done
+void ComputeSimulation::ReadCounts(bool wait) {
+    while (this->pending > 0) {
+        CountSlot& slot = this->countSlots[(this->step - this->pending) % COUNT_SLOTS];
+
+        GLenum result;
+        GLCALL(result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0));
+        while (wait && result == GL_TIMEOUT_EXPIRED) {
+            GLCALL(result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_NANOSECONDS));
+        }
+        if (result == GL_TIMEOUT_EXPIRED) {
+            return;
+        }
+        if (result == GL_WAIT_FAILED) {
+            throw std::runtime_error("Failed to wait for the cell count of a step");
+        }
+        wait = false;
+
+        GLCALL(glDeleteSync(slot.fence));
+        slot.fence = 0;
+        GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer));
+        GLCALL(glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint), &this->N));
+        GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+        this->pending -= 1;
+    }
+}
+
+void ComputeSimulation::Init(const Population& population) {
+    GLCALL(glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &this->maxGroups));
+    GLCALL(glGenBuffers(1, &this->flagsBuffer));
+    GLCALL(glGenBuffers(1, &this->offsetsBuffer));
+    GLCALL(glGenBuffers(1, &this->totalsBuffer));
+    GLCALL(glGenBuffers(1, &this->argumentsBuffer));
+    for (CountSlot& slot : this->countSlots) {
+        GLCALL(glGenBuffers(1, &slot.buffer));
+        GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer));
+        GLCALL(glBufferData(GL_COPY_WRITE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_READ));
+    }
+
+    // Upload the population once, giving its cells new IDs kept in their instance
+    unsigned int count = population.Count();
+    this->Allocate(std::max(2 * count, INITIAL_CAPACITY));
+    std::vector<CellInstance> instances(count);
+    Cells::CopyCellData(population, instances.data());
+    for (unsigned int i = 0; i < count; ++i) {
+        instances[i].id[0] = i;
+        instances[i].id[1] = 0;
+    }
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, this->stateBuffers[this->current]));
+    GLCALL(glBufferSubData(GL_COPY_WRITE_BUFFER, 0, count * sizeof(CellInstance), instances.data()));
+    this->N = count;
+
+    // The cells start as the totals of a step without daughters, and the daughters are numbered after them
+    GLuint totals[2] = { count, 0 };
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, this->totalsBuffer));
+    GLCALL(glBufferData(GL_COPY_WRITE_BUFFER, sizeof(totals), totals, GL_DYNAMIC_COPY));
+    std::vector<GLuint> arguments(ARGUMENTS_SIZE / sizeof(GLuint), 0);
+    arguments[NEXT_ID_OFFSET / sizeof(GLuint)] = count;
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, this->argumentsBuffer));
+    GLCALL(glBufferData(GL_COPY_WRITE_BUFFER, ARGUMENTS_SIZE, arguments.data(), GL_DYNAMIC_COPY));
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+    // The phase tables, the seed and the size of the cells never change
+    this->stepProgram.Activate();
+    GLCALL(glUniform1fv(this->stepProgram.GetUniformLocation("durationSeconds"), CellPhases::count, CellPhases::durationSeconds));
+    GLCALL(glUniform1fv(this->stepProgram.GetUniformLocation("deathHazardPerSecond"), CellPhases::count, CellPhases::deathHazardPerSecond));
+    GLCALL(glUniform2ui(this->stepProgram.GetUniformLocation("randomKey"), (GLuint)this->seed, (GLuint)(this->seed >> 32)));
+    GLCALL(glUniform1f(this->stepProgram.GetUniformLocation("crowdingPerCell"), CellPhases::Crowding(1, this->cellRadius)));
+
+    this->scatterProgram.Activate();
+    GLCALL(glUniform2ui(this->scatterProgram.GetUniformLocation("randomKey"), (GLuint)this->seed, (GLuint)(this->seed >> 32)));
+
+    this->argumentsProgram.Activate();
+    GLCALL(glUniform1ui(this->argumentsProgram.GetUniformLocation("maxGroups"), this->maxGroups));
+    this->WriteArguments();
+}
+
+// Step every cell by deltaSeconds
+void ComputeSimulation::Update(float deltaSeconds) {
+
+    // Read the counts of the steps the GPU has finished. Only when every slot of the ring
+    // is still waiting does the CPU wait for the GPU, on the oldest step
+    this->ReadCounts(false);
+    if (this->pending == COUNT_SLOTS) {
+        this->ReadCounts(true);
+    }
+
+    // Every cell can divide in the same step, and the cells can have doubled in each step since the
+    // last count read back. Newer counts are waited for before the buffers grow, and the buffers grow
+    // to leave room for the steps of the ring to be waiting again
+    while (2 * (this->N << this->pending) > this->capacity && this->pending > 0) {
+        this->ReadCounts(true);
+    }
+    if (2 * this->N > this->capacity) {
+        this->Allocate(std::max(2 * this->capacity, (2 * this->N) << (COUNT_SLOTS - 1)));
+        this->WriteArguments();
+    }
+    unsigned int next = 1 - this->current;
+
+    // Every dispatch is sized by the GPU from the cell count it keeps
+    GLCALL(glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, this->argumentsBuffer));
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, this->argumentsBuffer));
+
+    // Step the cells in place, flag divisions and deaths and count the cells each one leaves
+    this->stepProgram.Activate();
+    this->stepIndexUniform.Set(this->step);
+    this->deltaSecondsUniform.Set(deltaSeconds);
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->stateBuffers[this->current]));
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, this->flagsBuffer));
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, this->offsetsBuffer));
+    this->Dispatch(0);
+    GLCALL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+
+    // Turn the counts into the index of the first cell each cell leaves, and the number of daughters before it
+    this->Scan(this->offsetsBuffer, 0);
+
+    // Pack the surviving cells and the daughters into the other buffer
+    this->scatterProgram.Activate();
+    this->scatterStepIndexUniform.Set(this->step);
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->stateBuffers[this->current]));
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->stateBuffers[next]));
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, this->flagsBuffer));
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, this->offsetsBuffer));
+    GLCALL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, this->totalsBuffer));
+    this->Dispatch(0);
+
+    // The new state is read by the next step and the instance buffer texture, the totals by the arguments pass
+    GLCALL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT));
+    this->WriteArguments();
+    GLCALL(glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0));
+
+    // Copy the new count into the slot of the step, it is read back once the fence has passed
+    CountSlot& slot = this->countSlots[this->step % COUNT_SLOTS];
+    GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, this->argumentsBuffer));
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, slot.buffer));
+    GLCALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, CELL_COUNT_OFFSET, 0, sizeof(GLuint)));
+    GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+    GLCALL(slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    this->pending += 1;
+
+    this->current = next;
+    this->simSeconds += deltaSeconds;
+    this->step += 1;
+}
+
+// Number of cells as of the last count read back, a few steps behind. Draw the cells with DrawBuffer
+GLuint ComputeSimulation::Count() const {
+    return this->N;
+}
+
+// Buffer holding the state after the last step, laid out as CellInstance. It changes on every step
+GLuint ComputeSimulation::StateBuffer() const {
+    return this->stateBuffers[this->current];
+}
+
+// Buffer holding the command to draw the cells of StateBuffer with glDrawArraysIndirect, at offset 0
+GLuint ComputeSimulation::DrawBuffer() const {
+    return this->argumentsBuffer;
+}
+
+double ComputeSimulation::GetSimSeconds() const {
+    return this->simSeconds;
+}
+
+// Whether the current context has compute shaders and shader storage buffers
+bool ComputeSimulation::Supported() {
+    return GLAD_GL_VERSION_4_3 != 0;
+}
+
+const static std::string philoxFilePath = SOURCE_DIRECTORY + "/shaders/philox.comp.glsl";
+const static std::string stepFilePath = SOURCE_DIRECTORY + "/shaders/step.comp.glsl";
+const static std::string scanFilePath = SOURCE_DIRECTORY + "/shaders/scan.comp.glsl";
+const static std::string scanAddFilePath = SOURCE_DIRECTORY + "/shaders/scanAdd.comp.glsl";
+const static std::string scatterFilePath = SOURCE_DIRECTORY + "/shaders/scatter.comp.glsl";
+const static std::string argumentsFilePath = SOURCE_DIRECTORY + "/shaders/arguments.comp.glsl";
+
+ComputeSimulation::ComputeSimulation(const Population& population, uint64_t seed) : N(0), cellRadius(population.GetCellRadius()), capacity(0), step(0), simSeconds(population.GetSimSeconds()),
+  seed(seed), stepProgram(std::vector<const char*>{ philoxFilePath.c_str(), stepFilePath.c_str() }),
+  scanProgram(std::vector<const char*>{ scanFilePath.c_str() }), scanAddProgram(std::vector<const char*>{ scanAddFilePath.c_str() }),
+  scatterProgram(std::vector<const char*>{ philoxFilePath.c_str(), scatterFilePath.c_str() }), argumentsProgram(std::vector<const char*>{ argumentsFilePath.c_str() }),
+  stepIndexUniform(stepProgram.GetUniform<GLuint>("stepIndex")), scanLevelUniform(scanProgram.GetUniform<GLuint>("level")),
+  scanAddLevelUniform(scanAddProgram.GetUniform<GLuint>("level")), scatterStepIndexUniform(scatterProgram.GetUniform<GLuint>("stepIndex")),
+  levelCountUniform(argumentsProgram.GetUniform<GLuint>("levelCount")), deltaSecondsUniform(stepProgram.GetUniform<GLfloat>("deltaSeconds")),
+  stateBuffers(), current(0), flagsBuffer(0), offsetsBuffer(0), totalsBuffer(0), argumentsBuffer(0), sumBuffers(), maxGroups(0), countSlots(), pending(0) {
+    this->Init(population);
+}
+
+void ComputeSimulation::Terminate() {
+    GLCALL(glDeleteBuffers(2, this->stateBuffers));
+    GLCALL(glDeleteBuffers(1, &this->flagsBuffer));
+    GLCALL(glDeleteBuffers(1, &this->offsetsBuffer));
+    GLCALL(glDeleteBuffers(1, &this->totalsBuffer));
+    GLCALL(glDeleteBuffers(1, &this->argumentsBuffer));
+    GLCALL(glDeleteBuffers(this->sumBuffers.size(), this->sumBuffers.data()));
+    for (CountSlot& slot : this->countSlots) {
+        GLCALL(glDeleteBuffers(1, &slot.buffer));
+        if (slot.fence) {
+            GLCALL(glDeleteSync(slot.fence));
+        }
+    }
+}
+
+ComputeSimulation::~ComputeSimulation() {
+    this->Terminate();
+}
@@ -0,0 +1,46 @@
+# pragma once
+
+namespace CellPhases {
+    const unsigned int count = 7;
+
+    enum Status: unsigned char {
+        g1, s, g2, // Interphase
+        pro, meta, ana, telo // Mitosis
+        // Note that cytokinesis happens instatly, this there is not status for it
+    };
+
+    // The Duration of each phase
+    static const float durationSeconds[count] = {
+        2.4, 2.1, 1.5,
+        1.0, 1.0, 1.0, 1.0,
+    };
+
+    // The radius at the start of each phase
+    static const float minRadius[count] = {
+        0.5, 0.9, 0.9,
+        1.0, 1.0, 1.0, 1.0
+    };
+
+    // The radius at the end of each phase
+    static const float maxRadius[count] = {
+        0.9, 0.9, 1.0,
+        1.0, 1.0, 1.0, 1.0
+    };
+
+    // Speed multiplier past which faster cells get no smaller
+    static const float radiusSpeedCap = 3.0;
+
+    // Chance per second that a cell dies in each phase when the cells cover the dish once. It is
+    // scaled by the crowding and by the speed multiplier of the cell, so a cell has the same chance
+    // to die before it divides however fast it cycles. Summed over the cycle it is ln 2, so the
+    // population levels off where half the cells die before dividing, with the dish about covered
+    static const float deathHazardPerSecond[count] = {
+        0.07, 0.035, 0.035,
+        0.1, 0.1, 0.1, 0.1
+    };
+
+    // Fraction of the dish, the square [-1, 1], that count cells of the largest radius would cover
+    inline float Crowding(unsigned int count, float cellRadius) {
+        return count * 3.14159265f * cellRadius * cellRadius / 4.0f;
+    }
+}
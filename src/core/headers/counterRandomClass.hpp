@@ -0,0 +1,64 @@
+# pragma once
+
+#include <cstdint>
+
+// Counter based random number generator (Philox 4x32-10). Every draw is a
+// pure function of the seed and a (cell ID, step, stream) counter, so no state
+// is shared between cells and the numbers do not depend on the order or the
+// thread the cells are updated on
+class CounterRandom {
+    uint32_t key[2];
+
+    static void Round(uint32_t counter[4], const uint32_t roundKey[2]) {
+        uint64_t product0 = (uint64_t)0xD2511F53 * counter[0];
+        uint64_t product1 = (uint64_t)0xCD9E8D57 * counter[2];
+
+        uint32_t result[4] = {
+            (uint32_t)(product1 >> 32) ^ counter[1] ^ roundKey[0],
+            (uint32_t)product1,
+            (uint32_t)(product0 >> 32) ^ counter[3] ^ roundKey[1],
+            (uint32_t)product0,
+        };
+
+        for (int i = 0; i < 4; ++i) {
+            counter[i] = result[i];
+        }
+    }
+
+public:
+    // Streams seperate the draws made for different purposes with the same cell and step
+    enum Stream: uint32_t {
+        initMotion, initCycle, division, death
+    };
+
+    CounterRandom(uint64_t seed) {
+        key[0] = (uint32_t)seed;
+        key[1] = (uint32_t)(seed >> 32);
+    }
+
+    // Fills bits with 4 random 32 bit numbers for the counter
+    void Bits(uint64_t id, uint32_t step, uint32_t stream, uint32_t bits[4]) const {
+        bits[0] = (uint32_t)id;
+        bits[1] = (uint32_t)(id >> 32);
+        bits[2] = step;
+        bits[3] = stream;
+
+        uint32_t roundKey[2] = { key[0], key[1] };
+        for (int round = 0; round < 10; ++round) {
+            Round(bits, roundKey);
+            roundKey[0] += 0x9E3779B9;
+            roundKey[1] += 0xBB67AE85;
+        }
+    }
+
+    // Fills values with 4 uniform random floats in [0, 1)
+    void Uniform(uint64_t id, uint32_t step, uint32_t stream, float values[4]) const {
+        uint32_t bits[4];
+        this->Bits(id, step, stream, bits);
+
+        // Use the top 24 bits so every value is exactly representable
+        for (int i = 0; i < 4; ++i) {
+            values[i] = (bits[i] >> 8) * (1.0f / 16777216.0f);
+        }
+    }
+};
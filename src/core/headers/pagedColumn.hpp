@@ -0,0 +1,88 @@
+# pragma once
+
+#include "alignedAllocator.hpp"
+#include <utility>
+#include <vector>
+
+// Per-cell column stored in fixed size blocks instead of one array. Growing
+// the column adds blocks without moving the ones already there, so appending
+// never copies the cells and the address of a cell stays the same while it
+// is in the column. Every block is cache line aligned and holds BLOCK_SIZE
+// cells, so the kernels can run over a block as one contiguous array
+template <typename T>
+class PagedColumn {
+public:
+	static constexpr unsigned int BLOCK_SHIFT = 12;
+	static constexpr unsigned int BLOCK_SIZE = 1u << BLOCK_SHIFT;
+
+private:
+	std::vector<Column<T>> blocks; // Blocks in cell order, all BLOCK_SIZE long
+	unsigned int count; // Number of cells in the column
+
+public:
+	T& operator[](unsigned int index) {
+		return this->blocks[index >> BLOCK_SHIFT][index & (BLOCK_SIZE - 1)];
+	}
+
+	const T& operator[](unsigned int index) const {
+		return this->blocks[index >> BLOCK_SHIFT][index & (BLOCK_SIZE - 1)];
+	}
+
+	unsigned int size() const {
+		return this->count;
+	}
+
+	// Number of blocks holding cells, the last one may be partly used
+	unsigned int block_count() const {
+		return (this->count + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+	}
+
+	// Start of a block, its cells are contiguous up to the end of the block
+	T* block(unsigned int block) {
+		return this->blocks[block].data();
+	}
+
+	const T* block(unsigned int block) const {
+		return this->blocks[block].data();
+	}
+
+	// Pointer to a cell, the cells after it are contiguous up to the end of its block
+	T* data(unsigned int index) {
+		return this->block(index >> BLOCK_SHIFT) + (index & (BLOCK_SIZE - 1));
+	}
+
+	const T* data(unsigned int index) const {
+		return this->block(index >> BLOCK_SHIFT) + (index & (BLOCK_SIZE - 1));
+	}
+
+	// Make sure there are blocks for count cells
+	void reserve(unsigned int count) {
+		while (this->blocks.size() * BLOCK_SIZE < count) {
+			this->blocks.emplace_back(BLOCK_SIZE);
+		}
+	}
+
+	// Blocks are kept when the column shrinks so that it can grow back without allocating.
+	// Cells added by growing are not cleared, they hold whatever was last stored there
+	void resize(unsigned int count) {
+		this->reserve(count);
+		this->count = count;
+	}
+
+	void push_back(const T& value) {
+		this->reserve(this->count + 1);
+		(*this)[this->count] = value;
+		this->count += 1;
+	}
+
+	void pop_back() {
+		this->count -= 1;
+	}
+
+	void swap(PagedColumn& other) {
+		this->blocks.swap(other.blocks);
+		std::swap(this->count, other.count);
+	}
+
+	PagedColumn() : count(0) {}
+};
@@ -0,0 +1,119 @@
+# pragma once
+
+#include "alignedAllocator.hpp"
+#include "counterRandomClass.hpp"
+#include "pagedColumn.hpp"
+#include "spatialGridClass.hpp"
+#include "threadPoolClass.hpp"
+#include "transitionSchedulerClass.hpp"
+#include "verletListClass.hpp"
+#include <cstdint>
+#include <vector>
+
+// Used for the dimension param of Population::GetPos and Population::GetVel methods
+# define X 0
+# define Y 1
+
+// Cell population model, kept free of any OpenGL state so it
+// can be stepped without a window or context.
+// Each property of the cells is stored in its own column, so
+// the passes in Update only touch the data they need.
+// In the analytic mode a step only visits the cells with an event due, the other cells
+// are left as they were at their record time and are worked out from it when needed
+class Population {
+	unsigned int N; // Number of cells
+	float r; // Largest cell radius
+	CounterRandom random; // Random numbers keyed by cell ID and step
+	ThreadPool threadPool; // Threads the per-cell passes are split across
+	uint32_t step; // Number of steps taken
+	double simSeconds; // Simulated seconds since the start
+	uint64_t nextId; // ID given to the next cell that is created
+	PagedColumn<uint64_t> id; // ID of each cell, it never changes for the life of the cell
+	PagedColumn<float> x, y; // Position of each particle
+	PagedColumn<float> vx, vy; // Velocity of each particle
+	PagedColumn<float> radius; // Current radius of each cell, only kept up to date while mechanics is on
+	PagedColumn<float> phaseProgress; // Duration in seconds in current stage of cycle
+	// Multipies the speed that each cell goes through the cell cycle, > 2.0 = cancer cell
+	// Faster cells die sooner by the same factor, so they are no more likely to die before dividing
+	PagedColumn<float> speedMultiplier;
+	PagedColumn<uint8_t> phase; // Current stage of the cycle of each cell, a CellPhases::Status
+	bool analytic; // Whether the position, velocity and progress of each cell are only brought up to date by its events
+	PagedColumn<double> recordSeconds; // Time the position, velocity and progress of each cell were taken at in the analytic mode
+	TransitionScheduler scheduler; // Time at which each cell is expected to finish its phase
+	std::vector<TransitionScheduler::Event> dueEvents; // Transitions that are due this step
+	std::vector<unsigned int> divisions; // Cells that completed the cycle this step
+	// Simulated seconds weighted by the crowding of the dish in each step. Deaths are scheduled on
+	// this clock, as the hazard of a cell is its phase hazard times the crowding
+	double crowdingSeconds;
+	PagedColumn<double> deathCrowdingSeconds; // Crowding seconds each cell dies at, unless it changes phase first
+	TransitionScheduler deathScheduler; // Crowding seconds at which each cell is due to die
+	std::vector<TransitionScheduler::Event> dueDeaths; // Deaths that are due this step
+	std::vector<unsigned int> deaths; // Cells that died this step
+	SpatialGrid grid; // Index of the cell positions for neighbour queries
+	float gridSquareSize; // Smallest square size of the grid, 0 when the grid is not kept
+	float stiffness; // Strength of the push between overlapping cells, 0 when cells pass through each other
+	VerletList verletList; // Cells close enough to push each other
+	std::vector<unsigned int> origin; // Index each cell had at the start of the step, the parent index for daughters
+	bool reordered; // Whether cells were added, removed or moved this step
+	PagedColumn<float> pushX, pushY; // Displacement of each cell from overlapping neighbours
+	float contactRadius; // Distance within which cells count as touching, 0 when G1 is never paused
+	unsigned int contactThreshold; // Most neighbours a G1 cell can touch and still grow
+	PagedColumn<uint8_t> inhibited; // 1 for the G1 cells that touch too many neighbours to grow this step
+	unsigned int sortInterval; // Steps between each sort of the cells into Morton order, 0 when they are never sorted
+	std::vector<uint64_t> sortKeys; // Morton key of each cell in the high half and its index in the low half
+	std::vector<unsigned int> sortOrder; // Index each cell had before the sort
+	std::vector<unsigned int> sortedIndex; // Index each cell has after the sort
+	// Columns the sort gathers into, one per element type. Each is swapped with the column it sorted,
+	// so it keeps the old blocks and the sort does not allocate once the population stops growing
+	PagedColumn<uint64_t> idScratch;
+	PagedColumn<float> floatScratch;
+	PagedColumn<uint8_t> phaseScratch;
+	PagedColumn<double> doubleScratch;
+	// Cells the last step changed other than by moving along their velocity and through their phases:
+	// parents, daughters, cells moved into the slot of a cell that died and, in the analytic mode, cells
+	// brought up to date by an event. Some can be past the last cell
+	std::vector<unsigned int> changed;
+	bool changedAll; // Whether the last step pushed, paused or sorted the cells, changed is then not filled
+
+	void Init();
+	void ScheduleTransition(unsigned int index);
+	void ScheduleDeath(unsigned int index);
+	void Advance(unsigned int index);
+	void StopAnalyticMotion();
+	void ApplyDivisions();
+	void Remove(unsigned int index);
+	void ApplyDeaths();
+	void ApplyMechanics(float deltaSeconds);
+	void FindInhibited();
+	void BuildGrid();
+	void SortByMorton();
+public:
+	void Update(float deltaSeconds);
+	unsigned int Count() const;
+	float GetPos(unsigned int dimension, unsigned int index) const;
+	float GetVel(unsigned int dimension, unsigned int index) const;
+	float GetRadius(unsigned int index) const;
+	uint8_t GetPhase(unsigned int index) const;
+	const PagedColumn<float>& GetPosColumn(unsigned int dimension) const;
+	const PagedColumn<float>& GetVelColumn(unsigned int dimension) const;
+	const PagedColumn<float>& GetRadiusColumn() const;
+	const PagedColumn<uint8_t>& GetPhaseColumn() const;
+	const PagedColumn<uint64_t>& GetIdColumn() const;
+	const PagedColumn<float>& GetPhaseProgressColumn() const;
+	const PagedColumn<float>& GetSpeedMultiplierColumn() const;
+	float GetCellRadius() const;
+	double GetSimSeconds() const;
+	double GetRecordSeconds(unsigned int index) const;
+	uint32_t GetStep() const;
+	const std::vector<unsigned int>& GetChangedCells() const;
+	bool AllCellsChanged() const;
+	unsigned int ThreadCount() const;
+	void EnableSpatialGrid(float queryRadius);
+	const SpatialGrid& GetGrid() const;
+	void EnableMechanics(float stiffness, float skin);
+	void EnableContactInhibition(float contactRadius, unsigned int threshold);
+	void EnableMortonSort(unsigned int everySteps);
+	void EnableAnalyticMotion();
+	void BringUpToDate();
+	Population(unsigned int N, float r, uint64_t seed, unsigned int threadCount);
+};
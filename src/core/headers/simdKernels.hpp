@@ -0,0 +1,39 @@
+# pragma once
+
+#include <cstdint>
+
+// Vectorised versions of the per-cell passes of Population::Update.
+// The widest instruction set the CPU supports is picked at run time,
+// every level gives bit identical results to the scalar code
+namespace SimdKernels {
+    enum Level: unsigned char {
+        scalar, sse4, avx2, avx512
+    };
+
+    // Widest level supported by this CPU
+    Level DetectLevel();
+
+    // Level the kernels currently use
+    Level GetLevel();
+
+    // Use a narrower level than detected, a level the CPU does not support is lowered to the detected one
+    void SetLevel(Level level);
+
+    const char* LevelName(Level level);
+
+    // Advance the time each cell has spent in its phase by deltaSeconds * speedMultiplier,
+    // cells with a non zero paused entry are left as they are. paused may be null
+    void AdvanceProgress(float* phaseProgress, const float* speedMultiplier, const uint8_t* paused, unsigned int count, float deltaSeconds);
+
+    // Move every cell by its velocity and fold the cells that went past a wall of [-1, 1]
+    // back inside, as if they bounced off it, flipping their velocity. For one dimension
+    void ReflectAndIntegrate(float* pos, float* vel, unsigned int count, float deltaSeconds);
+
+    // Fold one position back into [-1, 1] the same way, however far past the walls it is. The
+    // velocity is flipped for an odd number of bounces. It matches Fold in the vertex shaders
+    float Fold(float position, float& velocity);
+
+    // Interpolate the radius of each cell between the min and max radius
+    // of its phase, scaled by r / min(speedMultiplier, 3)
+    void UpdateRadius(float* radius, const uint8_t* phase, const float* phaseProgress, const float* speedMultiplier, unsigned int count, float r);
+}
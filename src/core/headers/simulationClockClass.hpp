@@ -0,0 +1,14 @@
+# pragma once
+
+// Fixed timestep clock, real time is added to an accumulator and
+// consumed in whole steps so results do not depend on the frame rate
+class SimulationClock {
+	double stepSeconds; // Simulated seconds per step
+	unsigned int maxSubsteps; // Most steps that can be taken in one frame
+	double accumulatorSeconds; // Real time that has not been simulated yet
+public:
+	unsigned int Advance(double frameSeconds);
+	float Alpha() const;
+	float StepSeconds() const;
+	SimulationClock(double stepSeconds, unsigned int maxSubsteps);
+};
@@ -0,0 +1,81 @@
+# pragma once
+
+#include "alignedAllocator.hpp"
+#include "pagedColumn.hpp"
+#include <algorithm>
+#include <vector>
+
+// Uniform grid over the [-1, 1] x [-1, 1] domain. The cells are counting
+// sorted by the grid square they are in, so the cells of a square are
+// contiguous and a radius query only visits the squares the radius covers
+class SpatialGrid {
+	unsigned int dimension; // Number of squares along each side
+	float squareSize; // Width of each square
+	std::vector<unsigned int> squareStart; // First sorted slot of each square, one extra entry marks the end
+	std::vector<unsigned int> squareOf; // Square of each cell
+	std::vector<unsigned int> sortedIndex; // Cell indices sorted by square
+	Column<float> sortedX, sortedY; // Cell positions in sorted order
+
+public:
+	unsigned int Square(float coordinate) const {
+		int square = (int)((coordinate + 1.0f) / this->squareSize);
+		return (unsigned int)std::clamp(square, 0, (int)this->dimension - 1);
+	}
+
+	void Build(const PagedColumn<float>& x, const PagedColumn<float>& y, unsigned int count, float minSquareSize);
+
+	// Calls visit(index, distanceSquared) for every cell within radius of (px, py). Any
+	// radius works, but a radius up to the square size visits at most 3 x 3 squares
+	template <typename Visit>
+	void ForEachNeighbour(float px, float py, float radius, Visit&& visit) const {
+		unsigned int firstColumn = this->Square(px - radius), lastColumn = this->Square(px + radius);
+		unsigned int firstRow = this->Square(py - radius), lastRow = this->Square(py + radius);
+		float radiusSquared = radius * radius;
+
+		for (unsigned int row = firstRow; row <= lastRow; ++row) {
+			// The squares of a row are contiguous in the sorted order
+			unsigned int begin = this->squareStart[row * this->dimension + firstColumn];
+			unsigned int end = this->squareStart[row * this->dimension + lastColumn + 1];
+
+			for (unsigned int slot = begin; slot < end; ++slot) {
+				float dx = this->sortedX[slot] - px;
+				float dy = this->sortedY[slot] - py;
+				float distanceSquared = dx * dx + dy * dy;
+				if (distanceSquared <= radiusSquared) {
+					visit(this->sortedIndex[slot], distanceSquared);
+				}
+			}
+		}
+	}
+
+	// Number of cells within radius of (px, py). The distance test has no branch so the
+	// loop over each contiguous row of squares vectorises
+	unsigned int CountNeighbours(float px, float py, float radius) const {
+		unsigned int firstColumn = this->Square(px - radius), lastColumn = this->Square(px + radius);
+		unsigned int firstRow = this->Square(py - radius), lastRow = this->Square(py + radius);
+		float radiusSquared = radius * radius;
+		const float* xs = this->sortedX.data();
+		const float* ys = this->sortedY.data();
+
+		unsigned int count = 0;
+		for (unsigned int row = firstRow; row <= lastRow; ++row) {
+			unsigned int begin = this->squareStart[row * this->dimension + firstColumn];
+			unsigned int end = this->squareStart[row * this->dimension + lastColumn + 1];
+
+			for (unsigned int slot = begin; slot < end; ++slot) {
+				float dx = xs[slot] - px;
+				float dy = ys[slot] - py;
+				count += dx * dx + dy * dy <= radiusSquared;
+			}
+		}
+		return count;
+	}
+
+	unsigned int Dimension() const;
+	float SquareSize() const;
+	unsigned int SquareStart(unsigned int square) const;
+	const unsigned int* SortedIndex() const;
+	const float* SortedX() const;
+	const float* SortedY() const;
+	SpatialGrid();
+};
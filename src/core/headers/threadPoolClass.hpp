@@ -0,0 +1,34 @@
+# pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker threads that split a range of cells into chunks.
+// The threads are created once and sleep between calls to ParallelFor
+class ThreadPool {
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable workReady; // Signals the workers that a new range was posted
+	std::condition_variable workDone; // Signals the caller that every worker finished
+	const std::function<void(unsigned int, unsigned int)>* task; // Task of the current range
+	unsigned int count; // Size of the current range
+	unsigned int chunkSize; // Size of the chunks the range is split into
+	std::atomic<unsigned int> nextChunk; // Index of the next chunk that has not been claimed
+	unsigned int generation; // Increased each time a range is posted
+	unsigned int busyWorkers; // Workers that have not finished the current range
+	bool stopping;
+
+	void WorkerLoop();
+	void RunChunks();
+public:
+	unsigned int ThreadCount() const;
+	void ParallelFor(unsigned int count, unsigned int chunkSize, const std::function<void(unsigned int, unsigned int)>& task);
+	ThreadPool(unsigned int threadCount);
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+};
@@ -0,0 +1,36 @@
+# pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Calendar queue of phase transitions keyed on absolute simulation time, or of
+// deaths keyed on any other clock that only moves forward.
+// Events are kept in a ring of buckets of equal width, events past the end
+// of the ring wait in an overflow list until the ring reaches them
+class TransitionScheduler {
+public:
+	struct Event {
+		double timeSeconds; // Time on the clock of the scheduler the event is due at
+		unsigned int index; // Index of the cell when it was scheduled
+		uint64_t id; // ID of the cell, the event is stale if the cell at index has another ID
+	};
+
+private:
+	double bucketSeconds; // Width of each bucket
+	std::vector<std::vector<Event>> buckets; // Ring of buckets, the size is a power of 2
+	std::vector<Event> overflow; // Events too far in the future for the ring
+	long long cursor; // Absolute number of the earliest bucket that may hold events
+	long long overflowCheck; // Bucket at which the overflow list is next checked
+	unsigned int size; // Number of events
+
+	long long BucketOf(double timeSeconds) const;
+	void Insert(const Event& event);
+	void DrainOverflow();
+public:
+	void Schedule(unsigned int index, uint64_t id, double timeSeconds);
+	void PopDue(double timeSeconds, std::vector<Event>& due);
+	void Clear();
+	void Remap(const std::vector<unsigned int>& newIndex);
+	unsigned int Size() const;
+	TransitionScheduler(double bucketSeconds, unsigned int bucketCount);
+};
@@ -0,0 +1,32 @@
+# pragma once
+
+#include "alignedAllocator.hpp"
+#include "spatialGridClass.hpp"
+#include "threadPoolClass.hpp"
+#include <vector>
+
+// Neighbour list of every cell within the interaction cutoff plus a skin
+// distance. The list stays valid until the cells have moved, or the cutoff
+// has grown, by more than the skin allows, so it is rebuilt only every few steps.
+// The skin is sized on each build from how far the cells moved per step since the
+// last one, so a rebuild is due about every REBUILD_STEPS steps
+class VerletList {
+	float minSkin; // Smallest skin, used until the cells have been seen moving
+	float skin; // Extra distance kept in the list
+	float builtCutoff; // Cutoff the list was built for, without the skin
+	bool built;
+	unsigned int stepsSinceBuild; // Calls of NeedsRebuild since the list was built
+	float stepDistance; // Largest distance a cell moved per step since the last build
+	std::vector<unsigned int> offsets; // First neighbour of each cell, one extra entry marks the end
+	std::vector<unsigned int> neighbours; // Neighbours of every cell, in cell order
+	std::vector<std::vector<unsigned int>> chunkNeighbours; // Neighbours found by each chunk of a parallel build
+	Column<float> referenceX, referenceY; // Position of each cell when the list was built
+	SpatialGrid grid; // Grid used to find the pairs when building
+public:
+	bool NeedsRebuild(const PagedColumn<float>& x, const PagedColumn<float>& y, unsigned int count, float cutoff);
+	void Build(ThreadPool& threadPool, const PagedColumn<float>& x, const PagedColumn<float>& y, unsigned int count, float cutoff);
+	void Remap(ThreadPool& threadPool, const std::vector<unsigned int>& origin);
+	const unsigned int* NeighboursBegin(unsigned int index) const;
+	const unsigned int* NeighboursEnd(unsigned int index) const;
+	VerletList(float skin);
+};
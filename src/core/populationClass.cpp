@@ -0,0 +1,740 @@
+#include "headers/populationClass.hpp"
+#include "headers/cellPhases.hpp"
+#include "headers/simdKernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+float Population::GetPos(unsigned int dimension, unsigned int index) const {
+    return dimension == X ? this->x[index] : this->y[index];
+}
+
+float Population::GetVel(unsigned int dimension, unsigned int index) const {
+    return dimension == X ? this->vx[index] : this->vy[index];
+}
+
+float Population::GetRadius(unsigned int index) const {
+    return this->radius[index];
+}
+
+uint8_t Population::GetPhase(unsigned int index) const {
+    return this->phase[index];
+}
+
+const PagedColumn<float>& Population::GetPosColumn(unsigned int dimension) const {
+    return dimension == X ? this->x : this->y;
+}
+
+const PagedColumn<float>& Population::GetVelColumn(unsigned int dimension) const {
+    return dimension == X ? this->vx : this->vy;
+}
+
+const PagedColumn<float>& Population::GetRadiusColumn() const {
+    return this->radius;
+}
+
+const PagedColumn<uint8_t>& Population::GetPhaseColumn() const {
+    return this->phase;
+}
+
+const PagedColumn<uint64_t>& Population::GetIdColumn() const {
+    return this->id;
+}
+
+const PagedColumn<float>& Population::GetPhaseProgressColumn() const {
+    return this->phaseProgress;
+}
+
+const PagedColumn<float>& Population::GetSpeedMultiplierColumn() const {
+    return this->speedMultiplier;
+}
+
+float Population::GetCellRadius() const {
+    return this->r;
+}
+
+double Population::GetSimSeconds() const {
+    return this->simSeconds;
+}
+
+// Time the position, velocity and progress in the columns were taken at. Outside the analytic mode
+// every cell is up to date
+double Population::GetRecordSeconds(unsigned int index) const {
+    return this->analytic ? this->recordSeconds[index] : this->simSeconds;
+}
+
+uint32_t Population::GetStep() const {
+    return this->step;
+}
+
+const std::vector<unsigned int>& Population::GetChangedCells() const {
+    return this->changed;
+}
+
+bool Population::AllCellsChanged() const {
+    return this->changedAll;
+}
+
+unsigned int Population::Count() const {
+    return this->N;
+}
+
+void Population::Init() {
+
+    // Generate random particle positions and velocities
+    this->id.reserve(this->N);
+    this->x.reserve(this->N);
+    this->y.reserve(this->N);
+    this->vx.reserve(this->N);
+    this->vy.reserve(this->N);
+    for (unsigned int i = 0; i < this->N; ++i) {
+        float randomNumbers[4];
+        this->random.Uniform(i, 0, CounterRandom::initMotion, randomNumbers);
+
+        // Asign ID
+        this->id.push_back(this->nextId++);
+
+        // Randomly generate position in [-1, 1]
+        this->x.push_back(randomNumbers[0] * 2.0f - 1.0f);
+        this->y.push_back(randomNumbers[1] * 2.0f - 1.0f);
+
+        // Randomly generate velocity
+        this->vx.push_back((randomNumbers[2] * 2.0f - 1.0f) / 14.0f);
+        this->vy.push_back((randomNumbers[3] * 2.0f - 1.0f) / 14.0f);
+    }
+
+    // Randomly asign each cell a speed multiplier, a stage of the cycle and a point in that stage
+    this->speedMultiplier.reserve(this->N);
+    this->phase.reserve(this->N);
+    this->radius.reserve(this->N);
+    this->phaseProgress.reserve(this->N);
+    this->deathCrowdingSeconds.reserve(this->N);
+    for (unsigned int i = 0; i < this->N; ++i) {
+        float randomNumbers[4];
+        this->random.Uniform(i, 0, CounterRandom::initCycle, randomNumbers);
+
+        // Generate speed multiplier
+        this->speedMultiplier.push_back(1.0f + (randomNumbers[0] * 2.0f - 1.0f) * .2f);
+
+        CellPhases::Status cellPhase;
+        using namespace CellPhases;
+
+        unsigned int randomNumber = (unsigned int)(randomNumbers[1] * 100) + 1;
+
+        if (randomNumber <= 24) {
+            cellPhase = g1;
+        }
+        else if (randomNumber <= 45) {
+            cellPhase = s;
+        }
+        else if (randomNumber <= 60) {
+            cellPhase = g2;
+        }
+        else if (randomNumber <= 70) {
+            cellPhase = pro;
+        }
+        else if (randomNumber <= 80) {
+            cellPhase = meta;
+        }
+        else if (randomNumber <= 90) {
+            cellPhase = ana;
+        }
+        else {
+            cellPhase = telo;
+        }
+
+        this->phase.push_back(cellPhase);
+        this->radius.push_back(this->r);
+
+        // Asign duration of the stage at random point
+        this->phaseProgress.push_back(randomNumbers[2] * durationSeconds[cellPhase]);
+
+        // Draw the crowding seconds the cell lives for in its phase
+        float hazard = deathHazardPerSecond[cellPhase] * this->speedMultiplier[i];
+        this->deathCrowdingSeconds.push_back(this->crowdingSeconds - std::log(1.0 - randomNumbers[3]) / hazard);
+    }
+    this->recordSeconds.resize(this->N);
+}
+
+// Number of cells in each chunk of the parallel passes, a multiple of every SIMD width.
+// Chunks are the blocks of the columns, so the kernels get one contiguous array per chunk
+const static unsigned int CHUNK_SIZE = PagedColumn<float>::BLOCK_SIZE;
+
+// How early a scheduled transition is checked, in simulated seconds
+const static double EVENT_SLACK_SECONDS = 1e-3;
+
+// Width and number of the scheduler buckets, the ring covers 16 simulated seconds
+const static double BUCKET_SECONDS = 1.0 / 64.0;
+const static unsigned int BUCKET_COUNT = 1024;
+
+// Spread the low 16 bits of value out to the even bits
+static uint32_t SpreadBits(uint32_t value) {
+    value &= 0x0000FFFF;
+    value = (value | (value << 8)) & 0x00FF00FF;
+    value = (value | (value << 4)) & 0x0F0F0F0F;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+    return value;
+}
+
+// Z-order key of a position in [-1, 1], positions just past a wall are put on it
+static uint32_t MortonKey(float x, float y) {
+    uint32_t column = (uint32_t)(std::min(std::max((x + 1.0f) * 0.5f, 0.0f), 1.0f) * 65535.0f);
+    uint32_t row = (uint32_t)(std::min(std::max((y + 1.0f) * 0.5f, 0.0f), 1.0f) * 65535.0f);
+    return SpreadBits(column) | (SpreadBits(row) << 1);
+}
+
+// Reorder a column so the cell at index k is the one that was at order[k]. The cells are gathered
+// into scratch and the two are swapped, so scratch is left with the blocks of the old order to reuse
+template<typename T>
+static void Gather(ThreadPool& threadPool, PagedColumn<T>& column, PagedColumn<T>& scratch, const std::vector<unsigned int>& order) {
+    scratch.resize(column.size());
+    threadPool.ParallelFor(order.size(), CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int k = begin; k < end; ++k) {
+            scratch[k] = column[order[k]];
+        }
+    });
+    column.swap(scratch);
+}
+
+// Tell the scheduler when a cell will have spent the full duration in its phase
+void Population::ScheduleTransition(unsigned int index) {
+    float remainingSeconds = CellPhases::durationSeconds[this->phase[index]] - this->phaseProgress[index];
+    this->scheduler.Schedule(index, this->id[index], this->GetRecordSeconds(index) + remainingSeconds / this->speedMultiplier[index]);
+}
+
+// Bring a cell in the analytic mode from its record time to now, the way the vertex shader draws it.
+// The position folds back off the walls and the progress grows, the phase only changes on the events
+void Population::Advance(unsigned int index) {
+    float elapsed = (float)this->simSeconds - (float)this->recordSeconds[index];
+    this->x[index] = SimdKernels::Fold(this->x[index] + this->vx[index] * elapsed, this->vx[index]);
+    this->y[index] = SimdKernels::Fold(this->y[index] + this->vy[index] * elapsed, this->vy[index]);
+    this->phaseProgress[index] += this->speedMultiplier[index] * elapsed;
+    this->recordSeconds[index] = this->simSeconds;
+}
+
+// Draw when a cell that just entered its phase dies, and tell the death scheduler. Time to death is
+// exponential, so drawing it again on each phase change gives the cell the hazard of its new phase
+void Population::ScheduleDeath(unsigned int index) {
+    float randomNumbers[4];
+    this->random.Uniform(this->id[index], this->step, CounterRandom::death, randomNumbers);
+
+    float hazard = CellPhases::deathHazardPerSecond[this->phase[index]] * this->speedMultiplier[index];
+    this->deathCrowdingSeconds[index] = this->crowdingSeconds - std::log(1.0 - randomNumbers[0]) / hazard;
+    this->deathScheduler.Schedule(index, this->id[index], this->deathCrowdingSeconds[index]);
+}
+
+// Append a daughter for every cell in the division buffer in one go
+void Population::ApplyDivisions() {
+    const std::vector<unsigned int>& parents = this->divisions;
+    if (parents.empty()) {
+        return;
+    }
+
+    // Grow every column once
+    unsigned int firstDaughter = this->N;
+    unsigned int count = this->N + parents.size();
+    this->id.resize(count);
+    this->x.resize(count);
+    this->y.resize(count);
+    this->vx.resize(count);
+    this->vy.resize(count);
+    this->radius.resize(count);
+    this->phaseProgress.resize(count);
+    this->speedMultiplier.resize(count);
+    this->phase.resize(count);
+    this->deathCrowdingSeconds.resize(count);
+    this->recordSeconds.resize(count);
+
+    this->threadPool.ParallelFor(parents.size(), CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int k = begin; k < end; ++k) {
+            unsigned int i = parents[k];
+            unsigned int daughter = firstDaughter + k;
+
+            // Give the new cell an ID
+            this->id[daughter] = this->nextId + k;
+
+            // Duplicate the position
+            this->x[daughter] = this->x[i];
+            this->y[daughter] = this->y[i];
+
+            // Duplicate and flip the velocity
+            this->vx[daughter] = this->vx[i] * -1;
+            this->vy[daughter] = this->vy[i] * -1;
+
+            // Duplicate the stage, radius and reset the status duration
+            this->phase[daughter] = this->phase[i];
+            this->radius[daughter] = this->radius[i];
+            this->phaseProgress[daughter] = 0.0;
+            this->recordSeconds[daughter] = this->recordSeconds[i];
+
+            // Modify the speedMultiplier values by a random amount in [-25%, 50%]
+            float randomNumbers[4];
+            this->random.Uniform(this->id[i], this->step, CounterRandom::division, randomNumbers);
+
+            float speedMultiplierMultiplier = 1.0f + (randomNumbers[0] * 1.5f - 0.5f) * .5f;
+            this->speedMultiplier[daughter] = speedMultiplier[i] * speedMultiplierMultiplier;
+
+            speedMultiplierMultiplier = 1.0f + (randomNumbers[1] * 1.5f - 0.5f) * .5f;
+            this->speedMultiplier[i] *= speedMultiplierMultiplier;
+        }
+    });
+
+    // Daughters start next to their parent, so they take over its neighbours
+    if (this->stiffness > 0.0f) {
+        this->origin.resize(count);
+        for (unsigned int k = 0; k < parents.size(); ++k) {
+            this->origin[firstDaughter + k] = this->origin[parents[k]];
+        }
+        this->reordered = true;
+    }
+
+    // Increase the number of cells by the number of daughters
+    this->nextId += parents.size();
+    this->N = count;
+
+    // Parents got a new speed multiplier, so both cells are scheduled now, and both start G1
+    for (unsigned int k = 0; k < parents.size(); ++k) {
+        this->ScheduleTransition(parents[k]);
+        this->ScheduleTransition(firstDaughter + k);
+        this->ScheduleDeath(parents[k]);
+        this->ScheduleDeath(firstDaughter + k);
+    }
+    if (!this->changedAll) {
+        this->changed.insert(this->changed.end(), parents.begin(), parents.end());
+        for (unsigned int daughter = firstDaughter; daughter < count; ++daughter) {
+            this->changed.push_back(daughter);
+        }
+    }
+    this->divisions.clear();
+}
+
+// Remove a cell in O(1) by moving the last cell into its slot
+void Population::Remove(unsigned int index) {
+    unsigned int last = this->N - 1;
+
+    if (index != last) {
+        this->id[index] = this->id[last];
+        this->x[index] = this->x[last];
+        this->y[index] = this->y[last];
+        this->vx[index] = this->vx[last];
+        this->vy[index] = this->vy[last];
+        this->radius[index] = this->radius[last];
+        this->phaseProgress[index] = this->phaseProgress[last];
+        this->speedMultiplier[index] = this->speedMultiplier[last];
+        this->phase[index] = this->phase[last];
+        this->deathCrowdingSeconds[index] = this->deathCrowdingSeconds[last];
+        this->recordSeconds[index] = this->recordSeconds[last];
+
+        // The events of the moved cell still point at its old index, so it gets new ones at the same times
+        this->ScheduleTransition(index);
+        this->deathScheduler.Schedule(index, this->id[index], this->deathCrowdingSeconds[index]);
+        if (!this->changedAll) {
+            this->changed.push_back(index);
+        }
+    }
+
+    if (this->stiffness > 0.0f) {
+        this->origin[index] = this->origin[last];
+        this->origin.pop_back();
+        this->reordered = true;
+    }
+
+    this->id.pop_back();
+    this->x.pop_back();
+    this->y.pop_back();
+    this->vx.pop_back();
+    this->vy.pop_back();
+    this->radius.pop_back();
+    this->phaseProgress.pop_back();
+    this->speedMultiplier.pop_back();
+    this->phase.pop_back();
+    this->deathCrowdingSeconds.pop_back();
+    this->recordSeconds.pop_back();
+    this->N -= 1;
+}
+
+// Remove every cell in the death buffer
+void Population::ApplyDeaths() {
+
+    // Removing the highest index first means the last cell, which is moved into the freed slot, is never one that died
+    std::sort(this->deaths.begin(), this->deaths.end(), std::greater<unsigned int>());
+    this->deaths.erase(std::unique(this->deaths.begin(), this->deaths.end()), this->deaths.end());
+    for (unsigned int index : this->deaths) {
+        this->Remove(index);
+    }
+    this->deaths.clear();
+}
+
+// Push overlapping cells apart with a soft sphere force, proportional to how far
+// they overlap. Cells have no inertia so the force moves them directly
+void Population::ApplyMechanics(float deltaSeconds) {
+
+    // Bring the neighbour list over to the new cell order, or rebuild it if the cells moved too far
+    if (this->reordered) {
+        this->verletList.Remap(this->threadPool, this->origin);
+    }
+
+    float largestRadius = 0.0f;
+    for (unsigned int block = 0; block < this->radius.block_count(); ++block) {
+        const float* radii = this->radius.block(block);
+        unsigned int count = std::min(this->N - block * CHUNK_SIZE, CHUNK_SIZE);
+        largestRadius = std::max(largestRadius, *std::max_element(radii, radii + count));
+    }
+    float cutoff = 2.0f * largestRadius;
+    if (this->verletList.NeedsRebuild(this->x, this->y, this->N, cutoff)) {
+        this->verletList.Build(this->threadPool, this->x, this->y, this->N, cutoff);
+    }
+
+    // Push on a cell from one neighbour
+    struct Contact {
+        uint64_t id; // ID of the neighbour
+        float forceX, forceY;
+    };
+
+    // Find the push on each cell from the positions at the start of the pass
+    this->pushX.resize(this->N);
+    this->pushY.resize(this->N);
+    this->threadPool.ParallelFor(this->N, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+        std::vector<Contact> contacts;
+
+        for (unsigned int i = begin; i < end; ++i) {
+            contacts.clear();
+            float xi = this->x[i], yi = this->y[i], radiusi = this->radius[i];
+            for (const unsigned int* j = this->verletList.NeighboursBegin(i); j != this->verletList.NeighboursEnd(i); ++j) {
+                float dx = xi - this->x[*j];
+                float dy = yi - this->y[*j];
+                float distanceSquared = dx * dx + dy * dy;
+                float contact = radiusi + this->radius[*j];
+
+                // Cells on top of each other have no direction to be pushed in, their velocities separate them
+                if (distanceSquared < contact * contact && distanceSquared > 0.0f) {
+                    float distance = std::sqrt(distanceSquared);
+                    float push = this->stiffness * (contact - distance) / distance;
+                    contacts.push_back({ this->id[*j], push * dx, push * dy });
+                }
+            }
+
+            // Add the pushes in the order of the neighbour IDs, so the rounding of the sum does not
+            // depend on the order the cells are stored in
+            if (contacts.size() > 1) {
+                std::sort(contacts.begin(), contacts.end(), [](const Contact& a, const Contact& b) {
+                    return a.id < b.id;
+                });
+            }
+            float forceX = 0.0f, forceY = 0.0f;
+            for (const Contact& contact : contacts) {
+                forceX += contact.forceX;
+                forceY += contact.forceY;
+            }
+
+            this->pushX[i] = forceX * deltaSeconds;
+            this->pushY[i] = forceY * deltaSeconds;
+        }
+    });
+
+    this->threadPool.ParallelFor(this->N, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            this->x[i] += this->pushX[i];
+            this->y[i] += this->pushY[i];
+        }
+    });
+}
+
+// Mark the G1 cells with more than contactThreshold neighbours within contactRadius.
+// The cells are visited in the order of the grid so the cells near each other are counted
+// together, and the neighbours of each are read from the packed positions of the grid
+void Population::FindInhibited() {
+    this->inhibited.resize(this->N);
+    const unsigned int* sortedIndex = this->grid.SortedIndex();
+    const float* sortedX = this->grid.SortedX();
+    const float* sortedY = this->grid.SortedY();
+
+    this->threadPool.ParallelFor(this->N, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int slot = begin; slot < end; ++slot) {
+            unsigned int i = sortedIndex[slot];
+
+            if (this->phase[i] != CellPhases::Status::g1) {
+                this->inhibited[i] = 0;
+                continue;
+            }
+
+            // The count includes the cell itself
+            unsigned int neighbours = this->grid.CountNeighbours(sortedX[slot], sortedY[slot], this->contactRadius) - 1;
+            this->inhibited[i] = neighbours > this->contactThreshold;
+        }
+    });
+}
+
+// Sort the cells along a Z-order curve so cells close in space are close in memory.
+// Daughters are added at the end of the columns, far from their parents, so without
+// it the neighbour passes jump around the columns more and more as the cells divide
+void Population::SortByMorton() {
+
+    // Ties keep their current order, so the sort is the same on every run. In the analytic mode the
+    // cells are keyed on where they are now, but their records are left as they are
+    this->sortKeys.resize(this->N);
+    this->threadPool.ParallelFor(this->N, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; ++i) {
+            float px = this->x[i], py = this->y[i];
+            if (this->analytic) {
+                float elapsed = (float)this->simSeconds - (float)this->recordSeconds[i];
+                float vx = this->vx[i], vy = this->vy[i];
+                px = SimdKernels::Fold(px + vx * elapsed, vx);
+                py = SimdKernels::Fold(py + vy * elapsed, vy);
+            }
+            this->sortKeys[i] = ((uint64_t)MortonKey(px, py) << 32) | i;
+        }
+    });
+    std::sort(this->sortKeys.begin(), this->sortKeys.end());
+
+    this->sortOrder.resize(this->N);
+    this->sortedIndex.resize(this->N);
+    for (unsigned int k = 0; k < this->N; ++k) {
+        this->sortOrder[k] = (uint32_t)this->sortKeys[k];
+        this->sortedIndex[this->sortOrder[k]] = k;
+    }
+
+    // Move every column into the new order, the ID of each cell goes with it
+    Gather(this->threadPool, this->id, this->idScratch, this->sortOrder);
+    Gather(this->threadPool, this->x, this->floatScratch, this->sortOrder);
+    Gather(this->threadPool, this->y, this->floatScratch, this->sortOrder);
+    Gather(this->threadPool, this->vx, this->floatScratch, this->sortOrder);
+    Gather(this->threadPool, this->vy, this->floatScratch, this->sortOrder);
+    Gather(this->threadPool, this->radius, this->floatScratch, this->sortOrder);
+    Gather(this->threadPool, this->phaseProgress, this->floatScratch, this->sortOrder);
+    Gather(this->threadPool, this->speedMultiplier, this->floatScratch, this->sortOrder);
+    Gather(this->threadPool, this->phase, this->phaseScratch, this->sortOrder);
+    Gather(this->threadPool, this->deathCrowdingSeconds, this->doubleScratch, this->sortOrder);
+    Gather(this->threadPool, this->recordSeconds, this->doubleScratch, this->sortOrder);
+
+    // Point the pending transitions and the neighbour list at the new indices
+    this->changedAll = true;
+    this->scheduler.Remap(this->sortedIndex);
+    this->deathScheduler.Remap(this->sortedIndex);
+    if (this->stiffness > 0.0f) {
+        this->verletList.Remap(this->threadPool, this->sortOrder);
+    }
+}
+
+// Rebuild the grid with squares large enough for both the queries it was enabled for and contact inhibition
+void Population::BuildGrid() {
+    this->grid.Build(this->x, this->y, this->N, std::max(this->gridSquareSize, this->contactRadius));
+}
+
+void Population::Update(float deltaSeconds) {
+
+    // Track where each cell came from while the cells are added and removed
+    if (this->stiffness > 0.0f) {
+        this->origin.resize(this->N);
+        for (unsigned int i = 0; i < this->N; ++i) {
+            this->origin[i] = i;
+        }
+        this->reordered = false;
+    }
+
+    // Pushed and paused cells leave their velocity and their phase timers, so every cell counts as changed
+    bool inhibition = this->contactRadius > 0.0f;
+    this->changed.clear();
+    this->changedAll = this->stiffness > 0.0f || inhibition;
+
+    // Crowded G1 cells stop growing, the grid still holds the positions from the end of the last step
+    if (inhibition) {
+        this->FindInhibited();
+    }
+
+    // Update the amount of time each cell has been in its current phase, the analytic mode works it out when it is needed
+    if (!this->analytic) {
+        this->threadPool.ParallelFor(this->N, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+            SimdKernels::AdvanceProgress(this->phaseProgress.data(begin), this->speedMultiplier.data(begin), inhibition ? this->inhibited.data(begin) : nullptr, end - begin, deltaSeconds);
+        });
+    }
+    this->simSeconds += deltaSeconds;
+
+    // Only the cells the scheduler expects to finish their phase are checked. The check is made
+    // a little early so rounding in the progress can never make a transition late
+    this->dueEvents.clear();
+    this->scheduler.PopDue(this->simSeconds + EVENT_SLACK_SECONDS, this->dueEvents);
+
+    // Handle the transitions in ID order, so the daughters get their IDs in the order of the IDs of
+    // their parents. The IDs, and with them the random numbers, then do not depend on where the cells are stored
+    std::sort(this->dueEvents.begin(), this->dueEvents.end(), [](const TransitionScheduler::Event& a, const TransitionScheduler::Event& b) {
+        return a.id < b.id;
+    });
+
+    // Update cell cycle
+    for (const TransitionScheduler::Event& event : this->dueEvents) {
+        unsigned int i = event.index;
+
+        // Skip events of cells that died or were moved to another index
+        if (i >= this->N || this->id[i] != event.id) {
+            continue;
+        }
+
+        // A cell in the analytic mode is brought up to now, which gives it a new record
+        if (this->analytic) {
+            this->Advance(i);
+            this->changed.push_back(i);
+        }
+
+        // Check if the cell has been in the current phase for the full time it should
+        if (this->phaseProgress[i] >= CellPhases::durationSeconds[this->phase[i]]) {
+
+            // Move the cell to the next stage and reset the duration for it
+            this->phase[i] += 1;
+            this->phaseProgress[i] = 0.0;
+
+            // Wrap the cell back to g1-phase if it has completed the cycle and record it for division
+            if (this->phase[i] >= CellPhases::count) {
+                this->phase[i] = CellPhases::Status::g1;
+                this->divisions.push_back(i);
+                continue;
+            }
+            this->ScheduleDeath(i);
+        }
+
+        this->ScheduleTransition(i);
+    }
+
+    // Divide the cells that completed the cycle
+    this->ApplyDivisions();
+
+    // Run the crowding clock through the step and remove the cells whose time ran out, daughters included.
+    // Events of cells that died, moved or changed phase since they were scheduled are skipped
+    this->crowdingSeconds += CellPhases::Crowding(this->N, this->r) * deltaSeconds;
+    this->dueDeaths.clear();
+    this->deathScheduler.PopDue(this->crowdingSeconds, this->dueDeaths);
+    for (const TransitionScheduler::Event& event : this->dueDeaths) {
+        unsigned int i = event.index;
+        if (i < this->N && this->id[i] == event.id && this->deathCrowdingSeconds[i] == event.timeSeconds) {
+            this->deaths.push_back(i);
+        }
+    }
+    this->ApplyDeaths();
+
+    // Update the radius of the cells and push overlapping cells apart. Only the pushing needs the
+    // radius, the renderer works it out on the GPU from the phase, progress and speed multiplier
+    if (this->stiffness > 0.0f && this->N > 0) {
+        this->threadPool.ParallelFor(this->N, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+            SimdKernels::UpdateRadius(this->radius.data(begin), this->phase.data(begin), this->phaseProgress.data(begin), this->speedMultiplier.data(begin), end - begin, this->r);
+        });
+        this->ApplyMechanics(deltaSeconds);
+    }
+
+    // Update cells positon based on velocity, cells that went past a wall bounce off it
+    if (!this->analytic) {
+        this->threadPool.ParallelFor(this->N, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+            SimdKernels::ReflectAndIntegrate(this->x.data(begin), this->vx.data(begin), end - begin, deltaSeconds);
+            SimdKernels::ReflectAndIntegrate(this->y.data(begin), this->vy.data(begin), end - begin, deltaSeconds);
+        });
+    }
+
+    // Bring the cells back into spatial order every few steps
+    if (this->sortInterval > 0 && (this->step + 1) % this->sortInterval == 0) {
+        this->SortByMorton();
+    }
+
+    // Rebuild the neighbour index at the new positions
+    if (this->gridSquareSize > 0.0f || this->contactRadius > 0.0f) {
+        this->BuildGrid();
+    }
+
+    this->step += 1;
+}
+
+// Keep a spatial grid of the cells, rebuilt every step, sized for queries up to queryRadius.
+// A radius of 0 stops rebuilding it
+void Population::EnableSpatialGrid(float queryRadius) {
+    if (queryRadius > 0.0f) {
+        this->StopAnalyticMotion();
+    }
+    this->gridSquareSize = queryRadius;
+    if (this->gridSquareSize > 0.0f || this->contactRadius > 0.0f) {
+        this->BuildGrid();
+    }
+}
+
+// Make overlapping cells push each other apart. The neighbour list keeps pairs at least skin
+// further apart than the contact distance, it widens the skin to how far the cells move in a
+// few steps so it is not rebuilt every step. A stiffness of 0 turns the pushing off
+void Population::EnableMechanics(float stiffness, float skin) {
+    if (stiffness > 0.0f) {
+        this->StopAnalyticMotion();
+    }
+    this->stiffness = stiffness;
+    this->verletList = VerletList(skin);
+}
+
+// Pause the G1 growth of cells with more than threshold neighbours closer than contactRadius,
+// they carry on once the crowd around them thins out. A radius of 0 turns the pausing off
+void Population::EnableContactInhibition(float contactRadius, unsigned int threshold) {
+    if (contactRadius > 0.0f) {
+        this->StopAnalyticMotion();
+    }
+    this->contactRadius = contactRadius;
+    this->contactThreshold = threshold;
+    if (this->contactRadius > 0.0f) {
+        this->BuildGrid();
+    }
+}
+
+// Sort the cells into Morton order every everySteps steps. Indices of the cells change
+// when they are sorted, IDs do not. A value of 0 turns the sorting off
+void Population::EnableMortonSort(unsigned int everySteps) {
+    this->sortInterval = everySteps;
+}
+
+// Stop moving every cell each step. Each cell keeps its position, velocity and progress from
+// its record time, and is only brought up to date when it changes phase, divides or dies.
+// The columns then hold the records. Mechanics, contact inhibition and the spatial grid need
+// every cell where it is on every step, so they are turned off, and turning them on again ends the mode
+void Population::EnableAnalyticMotion() {
+    this->stiffness = 0.0f;
+    this->contactRadius = 0.0f;
+    this->gridSquareSize = 0.0f;
+
+    this->recordSeconds.resize(this->N);
+    for (unsigned int i = 0; i < this->N; ++i) {
+        this->recordSeconds[i] = this->simSeconds;
+    }
+    this->analytic = true;
+}
+
+// Bring every cell in the analytic mode up to now, so the columns hold the current state
+void Population::BringUpToDate() {
+    if (!this->analytic) {
+        return;
+    }
+    for (unsigned int i = 0; i < this->N; ++i) {
+        this->Advance(i);
+    }
+    this->changedAll = true;
+}
+
+void Population::StopAnalyticMotion() {
+    this->BringUpToDate();
+    this->analytic = false;
+}
+
+const SpatialGrid& Population::GetGrid() const {
+    return this->grid;
+}
+
+unsigned int Population::ThreadCount() const {
+    return this->threadPool.ThreadCount();
+}
+
+Population::Population(unsigned int N, float r, uint64_t seed, unsigned int threadCount)
+: N(N), r(r), random(seed), threadPool(threadCount), step(0), simSeconds(0.0), nextId(0), scheduler(BUCKET_SECONDS, BUCKET_COUNT),
+  analytic(false), crowdingSeconds(0.0), deathScheduler(BUCKET_SECONDS, BUCKET_COUNT), gridSquareSize(0.0f),
+  stiffness(0.0f), verletList(0.0f), reordered(false), contactRadius(0.0f), contactThreshold(0),
+  sortInterval(0), changedAll(true) {
+    this->Init();
+
+    // Schedule the first transition and the death of every cell
+    for (unsigned int i = 0; i < this->N; ++i) {
+        this->ScheduleTransition(i);
+        this->deathScheduler.Schedule(i, this->id[i], this->deathCrowdingSeconds[i]);
+    }
+}
@@ -0,0 +1,355 @@
+#include "headers/simdKernels.hpp"
+#include "headers/cellPhases.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    # define SIMD_KERNELS_X86
+    #include <immintrin.h>
+#endif
+
+// Note that the core library is compiled with -ffp-contract=off so a multiply
+// followed by an add is never fused, otherwise the levels would round differently
+
+namespace {
+    using namespace SimdKernels;
+
+    // Phase tables padded to 16 entries so a vector of phases can index them with a permute
+    struct PhaseTables {
+        alignas(64) float minRadius[16];
+        alignas(64) float radiusSpan[16];
+        alignas(64) float durationSeconds[16];
+
+        PhaseTables() {
+            for (unsigned int i = 0; i < 16; ++i) {
+                bool valid = i < CellPhases::count;
+                this->minRadius[i] = valid ? CellPhases::minRadius[i] : 0.0f;
+                this->radiusSpan[i] = valid ? CellPhases::maxRadius[i] - CellPhases::minRadius[i] : 0.0f;
+                this->durationSeconds[i] = valid ? CellPhases::durationSeconds[i] : 1.0f;
+            }
+        }
+    };
+
+    const PhaseTables tables;
+
+    //      SCALAR
+
+    void AdvanceProgressScalar(float* phaseProgress, const float* speedMultiplier, const uint8_t* paused, unsigned int begin, unsigned int end, float deltaSeconds) {
+        for (unsigned int i = begin; i < end; ++i) {
+            if (!paused || !paused[i]) {
+                phaseProgress[i] += deltaSeconds * speedMultiplier[i];
+            }
+        }
+    }
+
+    void ReflectAndIntegrateScalar(float* pos, float* vel, unsigned int begin, unsigned int end, float deltaSeconds) {
+        for (unsigned int i = begin; i < end; ++i) {
+            float v = vel[i];
+            pos[i] = SimdKernels::Fold(pos[i] + v * deltaSeconds, v);
+            vel[i] = v;
+        }
+    }
+
+    void UpdateRadiusScalar(float* radius, const uint8_t* phase, const float* phaseProgress, const float* speedMultiplier, unsigned int begin, unsigned int end, float r) {
+        for (unsigned int i = begin; i < end; ++i) {
+            uint8_t currentStage = phase[i];
+            float progressPercent = phaseProgress[i] / tables.durationSeconds[currentStage];
+            float cellRadius = tables.minRadius[currentStage] + tables.radiusSpan[currentStage] * progressPercent;
+            radius[i] = cellRadius * (r / std::min(speedMultiplier[i], CellPhases::radiusSpeedCap));
+        }
+    }
+
+#ifdef SIMD_KERNELS_X86
+
+    //      SSE4
+
+    __attribute__((target("sse4.1")))
+    void AdvanceProgressSse4(float* phaseProgress, const float* speedMultiplier, const uint8_t* paused, unsigned int count, float deltaSeconds) {
+        const __m128 delta = _mm_set1_ps(deltaSeconds);
+
+        unsigned int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 increment = _mm_mul_ps(delta, _mm_loadu_ps(speedMultiplier + i));
+
+            // Zero the increment of paused cells
+            if (paused) {
+                int pausedBytes;
+                std::memcpy(&pausedBytes, paused + i, sizeof(pausedBytes));
+                __m128i running = _mm_cmpeq_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(pausedBytes)), _mm_setzero_si128());
+                increment = _mm_and_ps(increment, _mm_castsi128_ps(running));
+            }
+
+            _mm_storeu_ps(phaseProgress + i, _mm_add_ps(_mm_loadu_ps(phaseProgress + i), increment));
+        }
+        AdvanceProgressScalar(phaseProgress, speedMultiplier, paused, i, count, deltaSeconds);
+    }
+
+    __attribute__((target("sse4.1")))
+    void ReflectAndIntegrateSse4(float* pos, float* vel, unsigned int count, float deltaSeconds) {
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 four = _mm_set1_ps(4.0f);
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        const __m128 delta = _mm_set1_ps(deltaSeconds);
+
+        unsigned int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 v = _mm_loadu_ps(vel + i);
+            __m128 shifted = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(pos + i), _mm_mul_ps(v, delta)), one);
+
+            // Position from the bottom wall along a path that goes up, bounces and comes back down, 4 long
+            __m128 wrapped = _mm_sub_ps(shifted, _mm_mul_ps(four, _mm_floor_ps(_mm_mul_ps(shifted, quarter))));
+            v = _mm_xor_ps(v, _mm_and_ps(_mm_cmpgt_ps(wrapped, two), signBit));
+
+            _mm_storeu_ps(vel + i, v);
+            _mm_storeu_ps(pos + i, _mm_sub_ps(one, _mm_andnot_ps(signBit, _mm_sub_ps(wrapped, two))));
+        }
+        ReflectAndIntegrateScalar(pos, vel, i, count, deltaSeconds);
+    }
+
+    __attribute__((target("sse4.1")))
+    void UpdateRadiusSse4(float* radius, const uint8_t* phase, const float* phaseProgress, const float* speedMultiplier, unsigned int count, float r) {
+        const __m128 three = _mm_set1_ps(CellPhases::radiusSpeedCap);
+        const __m128 maxRadius = _mm_set1_ps(r);
+
+        unsigned int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            // SSE has no permute by a vector of indices, so the tables are read one lane at a time
+            const uint8_t* s = phase + i;
+            __m128 duration = _mm_setr_ps(tables.durationSeconds[s[0]], tables.durationSeconds[s[1]], tables.durationSeconds[s[2]], tables.durationSeconds[s[3]]);
+            __m128 minimum = _mm_setr_ps(tables.minRadius[s[0]], tables.minRadius[s[1]], tables.minRadius[s[2]], tables.minRadius[s[3]]);
+            __m128 span = _mm_setr_ps(tables.radiusSpan[s[0]], tables.radiusSpan[s[1]], tables.radiusSpan[s[2]], tables.radiusSpan[s[3]]);
+
+            __m128 progressPercent = _mm_div_ps(_mm_loadu_ps(phaseProgress + i), duration);
+            __m128 cellRadius = _mm_add_ps(minimum, _mm_mul_ps(span, progressPercent));
+            __m128 scale = _mm_div_ps(maxRadius, _mm_min_ps(_mm_loadu_ps(speedMultiplier + i), three));
+
+            _mm_storeu_ps(radius + i, _mm_mul_ps(cellRadius, scale));
+        }
+        UpdateRadiusScalar(radius, phase, phaseProgress, speedMultiplier, i, count, r);
+    }
+
+    //      AVX2
+
+    __attribute__((target("avx2")))
+    void AdvanceProgressAvx2(float* phaseProgress, const float* speedMultiplier, const uint8_t* paused, unsigned int count, float deltaSeconds) {
+        const __m256 delta = _mm256_set1_ps(deltaSeconds);
+
+        unsigned int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 increment = _mm256_mul_ps(delta, _mm256_loadu_ps(speedMultiplier + i));
+
+            // Zero the increment of paused cells
+            if (paused) {
+                __m256i pausedLanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(paused + i)));
+                __m256i running = _mm256_cmpeq_epi32(pausedLanes, _mm256_setzero_si256());
+                increment = _mm256_and_ps(increment, _mm256_castsi256_ps(running));
+            }
+
+            _mm256_storeu_ps(phaseProgress + i, _mm256_add_ps(_mm256_loadu_ps(phaseProgress + i), increment));
+        }
+        AdvanceProgressScalar(phaseProgress, speedMultiplier, paused, i, count, deltaSeconds);
+    }
+
+    __attribute__((target("avx2")))
+    void ReflectAndIntegrateAvx2(float* pos, float* vel, unsigned int count, float deltaSeconds) {
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 two = _mm256_set1_ps(2.0f);
+        const __m256 four = _mm256_set1_ps(4.0f);
+        const __m256 quarter = _mm256_set1_ps(0.25f);
+        const __m256 signBit = _mm256_set1_ps(-0.0f);
+        const __m256 delta = _mm256_set1_ps(deltaSeconds);
+
+        unsigned int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 v = _mm256_loadu_ps(vel + i);
+            __m256 shifted = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(pos + i), _mm256_mul_ps(v, delta)), one);
+
+            __m256 wrapped = _mm256_sub_ps(shifted, _mm256_mul_ps(four, _mm256_floor_ps(_mm256_mul_ps(shifted, quarter))));
+            v = _mm256_xor_ps(v, _mm256_and_ps(_mm256_cmp_ps(wrapped, two, _CMP_GT_OQ), signBit));
+
+            _mm256_storeu_ps(vel + i, v);
+            _mm256_storeu_ps(pos + i, _mm256_sub_ps(one, _mm256_andnot_ps(signBit, _mm256_sub_ps(wrapped, two))));
+        }
+        ReflectAndIntegrateScalar(pos, vel, i, count, deltaSeconds);
+    }
+
+    __attribute__((target("avx2")))
+    void UpdateRadiusAvx2(float* radius, const uint8_t* phase, const float* phaseProgress, const float* speedMultiplier, unsigned int count, float r) {
+        const __m256 three = _mm256_set1_ps(CellPhases::radiusSpeedCap);
+        const __m256 maxRadius = _mm256_set1_ps(r);
+
+        // There are at most 8 phases so each table fits in one register
+        static_assert(CellPhases::count <= 8, "The AVX2 phase tables are looked up with an 8 lane permute");
+        const __m256 durationTable = _mm256_load_ps(tables.durationSeconds);
+        const __m256 minTable = _mm256_load_ps(tables.minRadius);
+        const __m256 spanTable = _mm256_load_ps(tables.radiusSpan);
+
+        unsigned int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256i stage = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(phase + i)));
+
+            __m256 progressPercent = _mm256_div_ps(_mm256_loadu_ps(phaseProgress + i), _mm256_permutevar8x32_ps(durationTable, stage));
+            __m256 cellRadius = _mm256_add_ps(_mm256_permutevar8x32_ps(minTable, stage), _mm256_mul_ps(_mm256_permutevar8x32_ps(spanTable, stage), progressPercent));
+            __m256 scale = _mm256_div_ps(maxRadius, _mm256_min_ps(_mm256_loadu_ps(speedMultiplier + i), three));
+
+            _mm256_storeu_ps(radius + i, _mm256_mul_ps(cellRadius, scale));
+        }
+        UpdateRadiusScalar(radius, phase, phaseProgress, speedMultiplier, i, count, r);
+    }
+
+    //      AVX-512
+
+    // The plain AVX-512 intrinsics of GCC pass an undefined vector as the merge source, which
+    // -Wmaybe-uninitialized reports. Their zero-masking forms with every lane set make the same
+    // instructions without it
+    const static __mmask16 ALL_LANES = 0xFFFF;
+
+    __attribute__((target("avx512f")))
+    void AdvanceProgressAvx512(float* phaseProgress, const float* speedMultiplier, const uint8_t* paused, unsigned int count, float deltaSeconds) {
+        const __m512 delta = _mm512_set1_ps(deltaSeconds);
+
+        unsigned int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m512 progress = _mm512_loadu_ps(phaseProgress + i);
+            __m512 increment = _mm512_mul_ps(delta, _mm512_loadu_ps(speedMultiplier + i));
+
+            // Only add to the lanes of cells that are not paused
+            __mmask16 running = 0xFFFF;
+            if (paused) {
+                __m512i pausedLanes = _mm512_maskz_cvtepu8_epi32(ALL_LANES, _mm_loadu_si128((const __m128i*)(paused + i)));
+                running = _mm512_testn_epi32_mask(pausedLanes, pausedLanes);
+            }
+
+            _mm512_storeu_ps(phaseProgress + i, _mm512_mask_add_ps(progress, running, progress, increment));
+        }
+        AdvanceProgressScalar(phaseProgress, speedMultiplier, paused, i, count, deltaSeconds);
+    }
+
+    __attribute__((target("avx512f")))
+    void ReflectAndIntegrateAvx512(float* pos, float* vel, unsigned int count, float deltaSeconds) {
+        const __m512 one = _mm512_set1_ps(1.0f);
+        const __m512 two = _mm512_set1_ps(2.0f);
+        const __m512 four = _mm512_set1_ps(4.0f);
+        const __m512 quarter = _mm512_set1_ps(0.25f);
+        const __m512 delta = _mm512_set1_ps(deltaSeconds);
+        const __m512i signBit = _mm512_set1_epi32((int)0x80000000);
+
+        unsigned int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m512 v = _mm512_loadu_ps(vel + i);
+            __m512 shifted = _mm512_add_ps(_mm512_add_ps(_mm512_loadu_ps(pos + i), _mm512_mul_ps(v, delta)), one);
+
+            __m512 floored = _mm512_maskz_roundscale_ps(ALL_LANES, _mm512_mul_ps(shifted, quarter), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+            __m512 wrapped = _mm512_sub_ps(shifted, _mm512_mul_ps(four, floored));
+            __mmask16 flip = _mm512_cmp_ps_mask(wrapped, two, _CMP_GT_OQ);
+            v = _mm512_castsi512_ps(_mm512_mask_xor_epi32(_mm512_castps_si512(v), flip, _mm512_castps_si512(v), signBit));
+            __m512 distance = _mm512_castsi512_ps(_mm512_maskz_andnot_epi32(ALL_LANES, signBit, _mm512_castps_si512(_mm512_sub_ps(wrapped, two))));
+
+            _mm512_storeu_ps(vel + i, v);
+            _mm512_storeu_ps(pos + i, _mm512_sub_ps(one, distance));
+        }
+        ReflectAndIntegrateScalar(pos, vel, i, count, deltaSeconds);
+    }
+
+    __attribute__((target("avx512f")))
+    void UpdateRadiusAvx512(float* radius, const uint8_t* phase, const float* phaseProgress, const float* speedMultiplier, unsigned int count, float r) {
+        const __m512 three = _mm512_set1_ps(CellPhases::radiusSpeedCap);
+        const __m512 maxRadius = _mm512_set1_ps(r);
+
+        static_assert(CellPhases::count <= 16, "The AVX-512 phase tables are looked up with a 16 lane permute");
+        const __m512 durationTable = _mm512_load_ps(tables.durationSeconds);
+        const __m512 minTable = _mm512_load_ps(tables.minRadius);
+        const __m512 spanTable = _mm512_load_ps(tables.radiusSpan);
+
+        unsigned int i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m512i stage = _mm512_maskz_cvtepu8_epi32(ALL_LANES, _mm_loadu_si128((const __m128i*)(phase + i)));
+
+            __m512 progressPercent = _mm512_div_ps(_mm512_loadu_ps(phaseProgress + i), _mm512_maskz_permutexvar_ps(ALL_LANES, stage, durationTable));
+            __m512 cellRadius = _mm512_add_ps(_mm512_maskz_permutexvar_ps(ALL_LANES, stage, minTable), _mm512_mul_ps(_mm512_maskz_permutexvar_ps(ALL_LANES, stage, spanTable), progressPercent));
+            __m512 scale = _mm512_div_ps(maxRadius, _mm512_maskz_min_ps(ALL_LANES, _mm512_loadu_ps(speedMultiplier + i), three));
+
+            _mm512_storeu_ps(radius + i, _mm512_mul_ps(cellRadius, scale));
+        }
+        UpdateRadiusScalar(radius, phase, phaseProgress, speedMultiplier, i, count, r);
+    }
+
+#endif
+
+    Level currentLevel = DetectLevel();
+}
+
+SimdKernels::Level SimdKernels::DetectLevel() {
+#ifdef SIMD_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return avx2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return sse4;
+    }
+#endif
+    return scalar;
+}
+
+SimdKernels::Level SimdKernels::GetLevel() {
+    return currentLevel;
+}
+
+void SimdKernels::SetLevel(Level level) {
+    currentLevel = std::min(level, DetectLevel());
+}
+
+const char* SimdKernels::LevelName(Level level) {
+    const char* names[] = { "scalar", "sse4", "avx2", "avx512" };
+    return names[level];
+}
+
+void SimdKernels::AdvanceProgress(float* phaseProgress, const float* speedMultiplier, const uint8_t* paused, unsigned int count, float deltaSeconds) {
+    switch (currentLevel) {
+#ifdef SIMD_KERNELS_X86
+        case avx512: AdvanceProgressAvx512(phaseProgress, speedMultiplier, paused, count, deltaSeconds); return;
+        case avx2: AdvanceProgressAvx2(phaseProgress, speedMultiplier, paused, count, deltaSeconds); return;
+        case sse4: AdvanceProgressSse4(phaseProgress, speedMultiplier, paused, count, deltaSeconds); return;
+#endif
+        default: AdvanceProgressScalar(phaseProgress, speedMultiplier, paused, 0, count, deltaSeconds); return;
+    }
+}
+
+void SimdKernels::ReflectAndIntegrate(float* pos, float* vel, unsigned int count, float deltaSeconds) {
+    switch (currentLevel) {
+#ifdef SIMD_KERNELS_X86
+        case avx512: ReflectAndIntegrateAvx512(pos, vel, count, deltaSeconds); return;
+        case avx2: ReflectAndIntegrateAvx2(pos, vel, count, deltaSeconds); return;
+        case sse4: ReflectAndIntegrateSse4(pos, vel, count, deltaSeconds); return;
+#endif
+        default: ReflectAndIntegrateScalar(pos, vel, 0, count, deltaSeconds); return;
+    }
+}
+
+float SimdKernels::Fold(float position, float& velocity) {
+    // Position from the bottom wall along a path that goes up, bounces and comes back down, 4 long
+    float shifted = position + 1.0f;
+    float wrapped = shifted - 4.0f * std::floor(shifted * 0.25f);
+    if (wrapped > 2.0f) {
+        velocity = -velocity;
+    }
+    return 1.0f - std::abs(wrapped - 2.0f);
+}
+
+void SimdKernels::UpdateRadius(float* radius, const uint8_t* phase, const float* phaseProgress, const float* speedMultiplier, unsigned int count, float r) {
+    switch (currentLevel) {
+#ifdef SIMD_KERNELS_X86
+        case avx512: UpdateRadiusAvx512(radius, phase, phaseProgress, speedMultiplier, count, r); return;
+        case avx2: UpdateRadiusAvx2(radius, phase, phaseProgress, speedMultiplier, count, r); return;
+        case sse4: UpdateRadiusSse4(radius, phase, phaseProgress, speedMultiplier, count, r); return;
+#endif
+        default: UpdateRadiusScalar(radius, phase, phaseProgress, speedMultiplier, 0, count, r); return;
+    }
+}
@@ -0,0 +1,35 @@
+#include "headers/simulationClockClass.hpp"
+#include <stdexcept>
+
+// Adds the real time of a frame and returns the number of fixed steps to simulate
+unsigned int SimulationClock::Advance(double frameSeconds) {
+    this->accumulatorSeconds += frameSeconds;
+
+    unsigned int steps = (unsigned int)(this->accumulatorSeconds / this->stepSeconds);
+
+    // Drop time that would take more than the allowed number of steps,
+    // otherwise a slow frame makes every following frame slower
+    if (steps > this->maxSubsteps) {
+        steps = this->maxSubsteps;
+        this->accumulatorSeconds = steps * this->stepSeconds;
+    }
+
+    this->accumulatorSeconds -= steps * this->stepSeconds;
+    return steps;
+}
+
+// Fraction of a step that is left in the accumulator, in [0, 1)
+float SimulationClock::Alpha() const {
+    return this->accumulatorSeconds / this->stepSeconds;
+}
+
+float SimulationClock::StepSeconds() const {
+    return this->stepSeconds;
+}
+
+SimulationClock::SimulationClock(double stepSeconds, unsigned int maxSubsteps)
+: stepSeconds(stepSeconds), maxSubsteps(maxSubsteps), accumulatorSeconds(0.0) {
+    if (stepSeconds <= 0.0) {
+        throw std::invalid_argument("Simulation step must be longer than 0 seconds.");
+    }
+}
@@ -0,0 +1,68 @@
+#include "headers/spatialGridClass.hpp"
+#include <algorithm>
+
+// Most squares along each side, so the square count fits an unsigned int and the grid stays a sane size
+const static unsigned int MAX_DIMENSION = 4096;
+
+// Sort the cells into squares at least minSquareSize wide with a counting sort
+void SpatialGrid::Build(const PagedColumn<float>& x, const PagedColumn<float>& y, unsigned int count, float minSquareSize) {
+
+    // Fit as many squares as possible along each side, at least one and at most MAX_DIMENSION.
+    // The limit is applied to the float so a tiny or zero size cannot overflow the conversion
+    float fitting = std::min(2.0f / minSquareSize, (float)MAX_DIMENSION);
+    this->dimension = (unsigned int)std::max(1.0f, fitting);
+    this->squareSize = 2.0f / this->dimension;
+    unsigned int squareCount = this->dimension * this->dimension;
+
+    // Count the cells in each square
+    this->squareStart.assign(squareCount + 1, 0);
+    this->squareOf.resize(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        unsigned int square = this->Square(y[i]) * this->dimension + this->Square(x[i]);
+        this->squareOf[i] = square;
+        this->squareStart[square + 1] += 1;
+    }
+
+    // Turn the counts into the first slot of each square
+    for (unsigned int square = 0; square < squareCount; ++square) {
+        this->squareStart[square + 1] += this->squareStart[square];
+    }
+
+    // Scatter the cells into their slots, keeping them in index order within a square
+    this->sortedIndex.resize(count);
+    this->sortedX.resize(count);
+    this->sortedY.resize(count);
+    std::vector<unsigned int> nextSlot(this->squareStart.begin(), this->squareStart.end() - 1);
+    for (unsigned int i = 0; i < count; ++i) {
+        unsigned int slot = nextSlot[this->squareOf[i]]++;
+        this->sortedIndex[slot] = i;
+        this->sortedX[slot] = x[i];
+        this->sortedY[slot] = y[i];
+    }
+}
+
+unsigned int SpatialGrid::Dimension() const {
+    return this->dimension;
+}
+
+float SpatialGrid::SquareSize() const {
+    return this->squareSize;
+}
+
+unsigned int SpatialGrid::SquareStart(unsigned int square) const {
+    return this->squareStart[square];
+}
+
+const unsigned int* SpatialGrid::SortedIndex() const {
+    return this->sortedIndex.data();
+}
+
+const float* SpatialGrid::SortedX() const {
+    return this->sortedX.data();
+}
+
+const float* SpatialGrid::SortedY() const {
+    return this->sortedY.data();
+}
+
+SpatialGrid::SpatialGrid() : dimension(1), squareSize(2.0f), squareStart(2, 0) {}
@@ -0,0 +1,102 @@
+#include "headers/threadPoolClass.hpp"
+#include <algorithm>
+
+// Claim chunks of the current range until there are none left
+void ThreadPool::RunChunks() {
+    unsigned int chunkCount = (this->count + this->chunkSize - 1) / this->chunkSize;
+
+    unsigned int chunk;
+    while ((chunk = this->nextChunk.fetch_add(1)) < chunkCount) {
+        unsigned int begin = chunk * this->chunkSize;
+        unsigned int end = std::min(begin + this->chunkSize, this->count);
+        (*this->task)(begin, end);
+    }
+}
+
+void ThreadPool::WorkerLoop() {
+    unsigned int seenGeneration = 0;
+
+    while (true) {
+        // Sleep until a new range is posted or the pool is destroyed
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->workReady.wait(lock, [&] { return this->stopping || this->generation != seenGeneration; });
+            if (this->stopping) {
+                return;
+            }
+            seenGeneration = this->generation;
+        }
+
+        this->RunChunks();
+
+        // Tell the caller once the last worker is done
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (--this->busyWorkers == 0) {
+            this->workDone.notify_one();
+        }
+    }
+}
+
+// Calls task(begin, end) for chunks of [0, count) on every thread, including the
+// calling one, and returns once all of them are done. Chunks start at multiples of chunkSize
+void ThreadPool::ParallelFor(unsigned int count, unsigned int chunkSize, const std::function<void(unsigned int, unsigned int)>& task) {
+    if (count == 0) {
+        return;
+    }
+
+    // Not worth waking the workers for a single chunk
+    if (this->workers.empty() || count <= chunkSize) {
+        for (unsigned int begin = 0; begin < count; begin += chunkSize) {
+            task(begin, std::min(begin + chunkSize, count));
+        }
+        return;
+    }
+
+    // Post the range
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->task = &task;
+        this->count = count;
+        this->chunkSize = chunkSize;
+        this->nextChunk = 0;
+        this->busyWorkers = this->workers.size();
+        this->generation += 1;
+    }
+    this->workReady.notify_all();
+
+    this->RunChunks();
+
+    // Wait for the workers to finish their last chunk
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->workDone.wait(lock, [&] { return this->busyWorkers == 0; });
+}
+
+// Number of threads that run chunks, including the calling thread
+unsigned int ThreadPool::ThreadCount() const {
+    return this->workers.size() + 1;
+}
+
+// A thread count of 0 uses every hardware thread
+ThreadPool::ThreadPool(unsigned int threadCount)
+: task(nullptr), count(0), chunkSize(1), nextChunk(0), generation(0), busyWorkers(0), stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    // The calling thread works too, so it needs one less worker
+    for (unsigned int i = 1; i < threadCount; ++i) {
+        this->workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->workReady.notify_all();
+
+    for (std::thread& worker : this->workers) {
+        worker.join();
+    }
+}
@@ -0,0 +1,116 @@
+#include "headers/transitionSchedulerClass.hpp"
+#include <cmath>
+#include <stdexcept>
+
+long long TransitionScheduler::BucketOf(double timeSeconds) const {
+    return (long long)std::floor(timeSeconds / this->bucketSeconds);
+}
+
+// Put an event in its bucket, or in the overflow list if the ring does not reach it yet
+void TransitionScheduler::Insert(const Event& event) {
+    long long bucket = this->BucketOf(event.timeSeconds);
+
+    // Events that are already due go in the earliest bucket
+    if (bucket < this->cursor) {
+        bucket = this->cursor;
+    }
+
+    if (bucket >= this->cursor + (long long)this->buckets.size()) {
+        this->overflow.push_back(event);
+    } else {
+        this->buckets[bucket & (this->buckets.size() - 1)].push_back(event);
+    }
+}
+
+// Move the overflow events the ring now reaches into their buckets
+void TransitionScheduler::DrainOverflow() {
+    std::vector<Event> waiting;
+    waiting.swap(this->overflow);
+    for (const Event& event : waiting) {
+        this->Insert(event);
+    }
+
+    // Check again once the ring moved half its length, before any waiting event can be reached
+    this->overflowCheck = this->cursor + this->buckets.size() / 2;
+}
+
+void TransitionScheduler::Schedule(unsigned int index, uint64_t id, double timeSeconds) {
+    this->Insert({ timeSeconds, index, id });
+    this->size += 1;
+}
+
+// Append every event at or before timeSeconds to due, in no particular order
+void TransitionScheduler::PopDue(double timeSeconds, std::vector<Event>& due) {
+    long long last = this->BucketOf(timeSeconds);
+
+    while (this->cursor <= last) {
+        if (this->cursor >= this->overflowCheck) {
+            this->DrainOverflow();
+        }
+
+        std::vector<Event>& bucket = this->buckets[this->cursor & (this->buckets.size() - 1)];
+
+        // The last bucket is only partly due
+        if (this->cursor == last) {
+            unsigned int kept = 0;
+            for (const Event& event : bucket) {
+                if (event.timeSeconds <= timeSeconds) {
+                    due.push_back(event);
+                } else {
+                    bucket[kept++] = event;
+                }
+            }
+            this->size -= bucket.size() - kept;
+            bucket.resize(kept);
+            break;
+        }
+
+        due.insert(due.end(), bucket.begin(), bucket.end());
+        this->size -= bucket.size();
+        bucket.clear();
+        this->cursor += 1;
+    }
+}
+
+// Move every event to the new index of its cell after the cells were reordered,
+// newIndex[i] is where the cell at index i went. Events past the end are left as they are
+void TransitionScheduler::Remap(const std::vector<unsigned int>& newIndex) {
+    auto remap = [&](std::vector<Event>& events) {
+        for (Event& event : events) {
+            if (event.index < newIndex.size()) {
+                event.index = newIndex[event.index];
+            }
+        }
+    };
+
+    for (std::vector<Event>& bucket : this->buckets) {
+        remap(bucket);
+    }
+    remap(this->overflow);
+}
+
+void TransitionScheduler::Clear() {
+    for (std::vector<Event>& bucket : this->buckets) {
+        bucket.clear();
+    }
+    this->overflow.clear();
+    this->size = 0;
+}
+
+unsigned int TransitionScheduler::Size() const {
+    return this->size;
+}
+
+// The bucket count is rounded up to a power of 2
+TransitionScheduler::TransitionScheduler(double bucketSeconds, unsigned int bucketCount)
+: bucketSeconds(bucketSeconds), cursor(0), overflowCheck(0), size(0) {
+    if (bucketSeconds <= 0.0 || bucketCount == 0) {
+        throw std::invalid_argument("Transition scheduler needs a positive bucket width and count.");
+    }
+
+    unsigned int ringSize = 1;
+    while (ringSize < bucketCount) {
+        ringSize *= 2;
+    }
+    this->buckets.resize(ringSize);
+}
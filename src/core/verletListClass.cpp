@@ -0,0 +1,181 @@
+#include "headers/verletListClass.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Cells in each chunk of the parallel passes, the size of a column block
+const static unsigned int CHUNK_SIZE = PagedColumn<float>::BLOCK_SIZE;
+
+// Steps the skin is sized to last for before the list is rebuilt
+const static float REBUILD_STEPS = 3.0f;
+
+// Largest skin as a multiple of the cutoff, so a burst of fast cells cannot make the list hold every cell
+const static float MAX_SKIN_CUTOFFS = 2.0f;
+
+// The list misses no pair within cutoff as long as the cutoff plus twice the
+// largest distance a cell moved since the build fits in the built cutoff plus the skin
+bool VerletList::NeedsRebuild(const PagedColumn<float>& x, const PagedColumn<float>& y, unsigned int count, float cutoff) {
+    if (!this->built || this->offsets.size() != count + 1) {
+        return true;
+    }
+
+    float maxDistanceSquared = 0.0f;
+    for (unsigned int i = 0; i < count; ++i) {
+        float dx = x[i] - this->referenceX[i];
+        float dy = y[i] - this->referenceY[i];
+        maxDistanceSquared = std::max(maxDistanceSquared, dx * dx + dy * dy);
+    }
+
+    // Each call is one step, the skin of the next build is sized from the distance per step
+    this->stepsSinceBuild += 1;
+    this->stepDistance = std::sqrt(maxDistanceSquared) / this->stepsSinceBuild;
+
+    float margin = this->builtCutoff + this->skin - cutoff;
+    return margin < 0.0f || 4.0f * maxDistanceSquared > margin * margin;
+}
+
+// Find the neighbours within cutoff plus the skin of every cell. Each chunk of cells
+// collects its neighbours on its own, then the chunks are joined in cell order
+void VerletList::Build(ThreadPool& threadPool, const PagedColumn<float>& x, const PagedColumn<float>& y, unsigned int count, float cutoff) {
+
+    // Two cells can close in on each other by twice the distance the fastest cell moves
+    if (this->stepsSinceBuild > 0) {
+        float wantedSkin = 2.0f * REBUILD_STEPS * this->stepDistance;
+        this->skin = std::max(this->minSkin, std::min(wantedSkin, MAX_SKIN_CUTOFFS * cutoff));
+    }
+    this->stepsSinceBuild = 0;
+
+    float listRadius = cutoff + this->skin;
+    this->grid.Build(x, y, count, listRadius);
+
+    // Offsets start out relative to the first neighbour of the chunk
+    unsigned int chunks = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    this->chunkNeighbours.resize(chunks);
+    this->offsets.resize(count + 1);
+    threadPool.ParallelFor(count, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+        std::vector<unsigned int>& found = this->chunkNeighbours[begin / CHUNK_SIZE];
+        found.clear();
+        for (unsigned int i = begin; i < end; ++i) {
+            this->offsets[i] = found.size();
+            this->grid.ForEachNeighbour(x[i], y[i], listRadius, [&](unsigned int j, float) {
+                if (j != i) {
+                    found.push_back(j);
+                }
+            });
+        }
+    });
+
+    // First neighbour of each chunk in the joined list
+    std::vector<unsigned int> chunkStart(chunks + 1, 0);
+    for (unsigned int chunk = 0; chunk < chunks; ++chunk) {
+        chunkStart[chunk + 1] = chunkStart[chunk] + this->chunkNeighbours[chunk].size();
+    }
+
+    this->neighbours.resize(chunkStart[chunks]);
+    this->referenceX.resize(count);
+    this->referenceY.resize(count);
+    threadPool.ParallelFor(count, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+        unsigned int chunk = begin / CHUNK_SIZE;
+        const std::vector<unsigned int>& found = this->chunkNeighbours[chunk];
+        std::copy(found.begin(), found.end(), this->neighbours.begin() + chunkStart[chunk]);
+        for (unsigned int i = begin; i < end; ++i) {
+            this->offsets[i] += chunkStart[chunk];
+            this->referenceX[i] = x[i];
+            this->referenceY[i] = y[i];
+        }
+    });
+    this->offsets[count] = chunkStart[chunks];
+
+    this->builtCutoff = cutoff;
+    this->built = true;
+}
+
+// Carry the list over to a new cell order without a rebuild. origin holds, for each new
+// index, the old index the cell came from, a daughter has the index of its parent. A cell
+// gets every image of its old neighbours, and its twin if it divided
+void VerletList::Remap(ThreadPool& threadPool, const std::vector<unsigned int>& origin) {
+    if (!this->built) {
+        return;
+    }
+
+    unsigned int oldCount = this->offsets.size() - 1;
+    unsigned int newCount = origin.size();
+
+    // Invert origin with a counting sort, giving the new indices of each old cell
+    std::vector<unsigned int> imageStart(oldCount + 1, 0);
+    for (unsigned int n = 0; n < newCount; ++n) {
+        imageStart[origin[n] + 1] += 1;
+    }
+    for (unsigned int k = 0; k < oldCount; ++k) {
+        imageStart[k + 1] += imageStart[k];
+    }
+    std::vector<unsigned int> images(newCount);
+    std::vector<unsigned int> nextImage(imageStart.begin(), imageStart.end() - 1);
+    for (unsigned int n = 0; n < newCount; ++n) {
+        images[nextImage[origin[n]]++] = n;
+    }
+
+    // Count the neighbours of each cell, the images of its old neighbours and its twins
+    std::vector<unsigned int> newOffsets(newCount + 1);
+    threadPool.ParallelFor(newCount, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int n = begin; n < end; ++n) {
+            unsigned int source = origin[n];
+            unsigned int size = imageStart[source + 1] - imageStart[source] - 1;
+            for (unsigned int k = this->offsets[source]; k < this->offsets[source + 1]; ++k) {
+                unsigned int neighbour = this->neighbours[k];
+                size += imageStart[neighbour + 1] - imageStart[neighbour];
+            }
+            newOffsets[n] = size;
+        }
+    });
+
+    // Turn the counts into the first neighbour of each cell
+    unsigned int total = 0;
+    for (unsigned int n = 0; n < newCount; ++n) {
+        unsigned int size = newOffsets[n];
+        newOffsets[n] = total;
+        total += size;
+    }
+    newOffsets[newCount] = total;
+
+    std::vector<unsigned int> newNeighbours(total);
+    Column<float> newReferenceX(newCount), newReferenceY(newCount);
+    threadPool.ParallelFor(newCount, CHUNK_SIZE, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int n = begin; n < end; ++n) {
+            unsigned int source = origin[n];
+            unsigned int slot = newOffsets[n];
+
+            // Images of the old neighbours
+            for (unsigned int k = this->offsets[source]; k < this->offsets[source + 1]; ++k) {
+                unsigned int neighbour = this->neighbours[k];
+                for (unsigned int m = imageStart[neighbour]; m < imageStart[neighbour + 1]; ++m) {
+                    newNeighbours[slot++] = images[m];
+                }
+            }
+
+            // Other images of the same old cell, the twin of a division
+            for (unsigned int m = imageStart[source]; m < imageStart[source + 1]; ++m) {
+                if (images[m] != n) {
+                    newNeighbours[slot++] = images[m];
+                }
+            }
+
+            newReferenceX[n] = this->referenceX[source];
+            newReferenceY[n] = this->referenceY[source];
+        }
+    });
+
+    this->offsets.swap(newOffsets);
+    this->neighbours.swap(newNeighbours);
+    this->referenceX.swap(newReferenceX);
+    this->referenceY.swap(newReferenceY);
+}
+
+const unsigned int* VerletList::NeighboursBegin(unsigned int index) const {
+    return this->neighbours.data() + this->offsets[index];
+}
+
+const unsigned int* VerletList::NeighboursEnd(unsigned int index) const {
+    return this->neighbours.data() + this->offsets[index + 1];
+}
+
+VerletList::VerletList(float skin) : minSkin(skin), skin(skin), builtCutoff(0.0f), built(false), stepsSinceBuild(0), stepDistance(0.0f) {}
@@ -0,0 +1,321 @@
+#include "headers/gpuSimulationClass.hpp"
+#include "headers/cellClass.hpp"
+#include "headers/openGLdebug.hpp"
+#include "core/headers/cellPhases.hpp"
+#include "core/headers/simdKernels.hpp"
+#include "srcDir.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Cells the buffers have room for before the first growth
+const static GLuint INITIAL_CAPACITY = 1024;
+
+// Give the state buffers room for capacity cells, the cells of the current state are kept
+void GpuSimulation::Allocate(GLuint capacity) {
+    GLuint buffers[2];
+    GLCALL(glGenBuffers(2, buffers));
+    for (GLuint buffer : buffers) {
+        GLCALL(glBindBuffer(GL_ARRAY_BUFFER, buffer));
+        GLCALL(glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(CellInstance), nullptr, GL_DYNAMIC_COPY));
+    }
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    // Copy the current state on the GPU, it never goes through the CPU
+    if (this->N > 0) {
+        GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, this->stateBuffers[this->current]));
+        GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[this->current]));
+        GLCALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, this->N * sizeof(CellInstance)));
+        GLCALL(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+        GLCALL(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+    }
+    GLCALL(glDeleteBuffers(2, this->stateBuffers));
+    std::copy(buffers, buffers + 2, this->stateBuffers);
+
+    // Point the VAO of each buffer at the position and velocity, then the phase progress, speed multiplier,
+    // phase and flags, then the ID. The last two are read as integers, the floats in them as their bits
+    for (unsigned int b = 0; b < 2; ++b) {
+        GLCALL(glBindVertexArray(this->stateVAOs[b]));
+        GLCALL(glBindBuffer(GL_ARRAY_BUFFER, this->stateBuffers[b]));
+        GLCALL(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(CellInstance), (void*)offsetof(CellInstance, x)));
+        GLCALL(glEnableVertexAttribArray(0));
+        GLCALL(glVertexAttribIPointer(1, 4, GL_UNSIGNED_INT, sizeof(CellInstance), (void*)offsetof(CellInstance, phaseProgress)));
+        GLCALL(glEnableVertexAttribArray(1));
+        GLCALL(glVertexAttribIPointer(2, 4, GL_UNSIGNED_INT, sizeof(CellInstance), (void*)offsetof(CellInstance, id)));
+        GLCALL(glEnableVertexAttribArray(2));
+    }
+    GLCALL(glBindVertexArray(0));
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    this->capacity = capacity;
+}
+
+void GpuSimulation::Init(const Population& population) {
+    GLCALL(glGenVertexArrays(2, this->stateVAOs));
+    for (EventSlot& slot : this->eventSlots) {
+        GLCALL(glGenBuffers(1, &slot.buffer));
+        GLCALL(glGenQueries(1, &slot.query));
+    }
+
+    // Give the cells of the population new IDs, they are kept in the instances from then on
+    unsigned int count = population.Count();
+    std::vector<CellInstance> instances(count);
+    Cells::CopyCellData(population, instances.data());
+    for (unsigned int i = 0; i < count; ++i) {
+        instances[i].id[0] = i;
+        instances[i].id[1] = 0;
+    }
+    this->nextId = count;
+
+    // Upload the population once, from then on the state stays on the GPU
+    this->Allocate(std::max(count, INITIAL_CAPACITY));
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, this->stateBuffers[this->current]));
+    GLCALL(glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(CellInstance), instances.data()));
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    this->N = count;
+    this->live = count;
+
+    // The phase tables and the seed never change
+    this->stepProgram.Activate();
+    GLCALL(glUniform1fv(this->stepProgram.GetUniformLocation("durationSeconds"), CellPhases::count, CellPhases::durationSeconds));
+    GLCALL(glUniform1fv(this->stepProgram.GetUniformLocation("deathHazardPerSecond"), CellPhases::count, CellPhases::deathHazardPerSecond));
+    GLCALL(glUniform2ui(this->stepProgram.GetUniformLocation("randomKey"), (GLuint)this->seed, (GLuint)(this->seed >> 32)));
+}
+
+// Step a daughter made in fromStep through the steps the GPU has run since, the way the step shader
+// would have. Those steps are all still waiting in the ring, which holds their lengths. Returns false
+// if the daughter died on the way. Daughters start in G1 and the ring holds fewer steps than there
+// are phases, so none of them can finish its cycle
+bool GpuSimulation::CatchUp(CellInstance& cell, uint32_t fromStep) const {
+    uint64_t id = cell.id[0] | ((uint64_t)cell.id[1] << 32);
+    float randomNumbers[4];
+
+    // The daughter rolls for death in the step it was made in, like the cells of the population
+    const EventSlot* slot = &this->eventSlots[fromStep % EVENT_SLOTS];
+    this->random.Uniform(id, fromStep, CounterRandom::death, randomNumbers);
+    if (randomNumbers[0] < CellPhases::deathHazardPerSecond[cell.phase] * cell.speedMultiplier * slot->crowding * slot->deltaSeconds) {
+        return false;
+    }
+
+    for (uint32_t s = fromStep + 1; s < this->step; ++s) {
+        slot = &this->eventSlots[s % EVENT_SLOTS];
+        float deltaSeconds = slot->deltaSeconds;
+
+        // Update the progress in the phase and move the cell to the next phase once it has been in it for its full duration
+        cell.phaseProgress += cell.speedMultiplier * deltaSeconds;
+        if (cell.phaseProgress >= CellPhases::durationSeconds[cell.phase]) {
+            cell.phase += 1;
+            cell.phaseProgress = 0.0f;
+        }
+
+        this->random.Uniform(id, s, CounterRandom::death, randomNumbers);
+        if (randomNumbers[0] < CellPhases::deathHazardPerSecond[cell.phase] * cell.speedMultiplier * slot->crowding * deltaSeconds) {
+            return false;
+        }
+
+        // Update the position based on the velocity, bouncing off the walls
+        cell.x = SimdKernels::Fold(cell.x + cell.vx * deltaSeconds, cell.vx);
+        cell.y = SimdKernels::Fold(cell.y + cell.vy * deltaSeconds, cell.vy);
+    }
+    return true;
+}
+
+// Free the slots of the cells that died in the step of slot and add a daughter for each cell that
+// finished its cycle in it, count is the number of events the wrap pass wrote
+void GpuSimulation::ApplyEvents(const EventSlot& slot, GLuint count) {
+    if (count == 0) {
+        return;
+    }
+
+    // The GPU is done with the events, so reading them back does not wait for it.
+    // Transform feedback keeps them in index order
+    this->events.resize(count);
+    GLCALL(glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, slot.buffer));
+    GLCALL(glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, count * sizeof(WrapEvent), this->events.data()));
+    GLCALL(glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0));
+
+    this->daughters.clear();
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, this->stateBuffers[this->current]));
+    for (const WrapEvent& event : this->events) {
+        GLuint i = event.index;
+
+        // The slot of a cell that died stays empty on the GPU until a daughter is put in it
+        if (event.state.flags & CELL_DIED) {
+            this->emptySlots.push_back(i);
+            this->live -= 1;
+        }
+        if (!(event.state.flags & CELL_DIVIDED)) {
+            continue;
+        }
+
+        // Duplicate the position, the phase and the progress, and flip the velocity
+        CellInstance daughter = event.state;
+        daughter.vx *= -1;
+        daughter.vy *= -1;
+        daughter.flags = 0;
+
+        // Modify the speedMultiplier values by a random amount in [-25%, 50%]
+        float randomNumbers[4];
+        this->random.Uniform(event.state.id[0] | ((uint64_t)event.state.id[1] << 32), slot.step, CounterRandom::division, randomNumbers);
+
+        float speedMultiplierMultiplier = 1.0f + (randomNumbers[0] * 1.5f - 0.5f) * .5f;
+        daughter.speedMultiplier = event.state.speedMultiplier * speedMultiplierMultiplier;
+
+        // The parent has run the steps since with its old speed multiplier, it changes from the next one.
+        // A parent that has died since only leaves an empty slot, the new value is not read there
+        speedMultiplierMultiplier = 1.0f + (randomNumbers[1] * 1.5f - 0.5f) * .5f;
+        GLfloat parentSpeedMultiplier = event.state.speedMultiplier * speedMultiplierMultiplier;
+        GLCALL(glBufferSubData(GL_ARRAY_BUFFER, i * sizeof(CellInstance) + offsetof(CellInstance, speedMultiplier), sizeof(GLfloat), &parentSpeedMultiplier));
+
+        // Give the new cell an ID
+        daughter.id[0] = (GLuint)this->nextId;
+        daughter.id[1] = (GLuint)(this->nextId >> 32);
+        this->nextId += 1;
+
+        if (this->CatchUp(daughter, slot.step)) {
+            this->daughters.push_back(daughter);
+        }
+    }
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    // Put the daughters in the empty slots first and append the rest, growing the buffers once
+    this->live += this->daughters.size();
+    GLuint appended = this->daughters.size() > this->emptySlots.size() ? this->daughters.size() - this->emptySlots.size() : 0;
+    if (this->N + appended > this->capacity) {
+        this->Allocate(std::max(2 * this->capacity, this->N + appended));
+    }
+
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, this->stateBuffers[this->current]));
+    GLuint k = 0;
+    for (; k < this->daughters.size() && !this->emptySlots.empty(); ++k) {
+        GLuint i = this->emptySlots.back();
+        this->emptySlots.pop_back();
+        GLCALL(glBufferSubData(GL_ARRAY_BUFFER, i * sizeof(CellInstance), sizeof(CellInstance), &this->daughters[k]));
+    }
+    if (k < this->daughters.size()) {
+        GLCALL(glBufferSubData(GL_ARRAY_BUFFER, this->N * sizeof(CellInstance), (this->daughters.size() - k) * sizeof(CellInstance), &this->daughters[k]));
+        this->N += this->daughters.size() - k;
+    }
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+// Apply the events of the waiting steps the GPU has finished, the oldest first. With wait the
+// oldest step is waited for, the others are only applied if they are already done
+void GpuSimulation::ReadEvents(bool wait) {
+    while (this->pending > 0) {
+        const EventSlot& slot = this->eventSlots[(this->step - this->pending) % EVENT_SLOTS];
+
+        GLuint available = GL_TRUE;
+        if (!wait) {
+            GLCALL(glGetQueryObjectuiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &available));
+        }
+        if (!available) {
+            return;
+        }
+        wait = false;
+
+        GLuint count;
+        GLCALL(glGetQueryObjectuiv(slot.query, GL_QUERY_RESULT, &count));
+        this->ApplyEvents(slot, count);
+        this->pending -= 1;
+    }
+}
+
+// Step every cell by deltaSeconds
+void GpuSimulation::Update(float deltaSeconds) {
+
+    // Add the daughters of the steps the GPU has finished. Only when every slot of the ring
+    // is still waiting does the CPU wait for the GPU, on the oldest step
+    this->ReadEvents(false);
+    if (this->pending == EVENT_SLOTS) {
+        this->ReadEvents(true);
+    }
+
+    // Every cell can finish its cycle or die in the same step. No step waits for the slot, so its buffer is free
+    EventSlot& slot = this->eventSlots[this->step % EVENT_SLOTS];
+    if (slot.capacity < this->N) {
+        slot.capacity = std::max(2 * slot.capacity, this->N);
+        GLCALL(glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, slot.buffer));
+        GLCALL(glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, slot.capacity * sizeof(WrapEvent), nullptr, GL_STREAM_READ));
+        GLCALL(glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0));
+    }
+    slot.step = this->step;
+    slot.deltaSeconds = deltaSeconds;
+    slot.crowding = CellPhases::Crowding(this->live, this->cellRadius);
+
+    unsigned int next = 1 - this->current;
+
+    // Nothing is drawn, the vertex shaders only write the captured varyings
+    GLCALL(glEnable(GL_RASTERIZER_DISCARD));
+
+    // Step the cells from the current buffer into the other one
+    this->stepProgram.Activate();
+    this->deltaSecondsUniform.Set(deltaSeconds);
+    this->crowdingUniform.Set(slot.crowding);
+    this->stepIndexUniform.Set(this->step);
+    GLCALL(glBindVertexArray(this->stateVAOs[this->current]));
+    GLCALL(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, this->stateBuffers[next]));
+    GLCALL(glBeginTransformFeedback(GL_POINTS));
+    GLCALL(glDrawArrays(GL_POINTS, 0, this->N));
+    GLCALL(glEndTransformFeedback());
+
+    // Pack the cells that finished their cycle or died into the event buffer of the step, and count them
+    this->wrapProgram.Activate();
+    GLCALL(glBindVertexArray(this->stateVAOs[next]));
+    GLCALL(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, slot.buffer));
+    GLCALL(glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, slot.query));
+    GLCALL(glBeginTransformFeedback(GL_POINTS));
+    GLCALL(glDrawArrays(GL_POINTS, 0, this->N));
+    GLCALL(glEndTransformFeedback());
+    GLCALL(glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN));
+
+    GLCALL(glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0));
+    GLCALL(glBindVertexArray(0));
+    GLCALL(glDisable(GL_RASTERIZER_DISCARD));
+
+    this->current = next;
+    this->simSeconds += deltaSeconds;
+    this->pending += 1;
+    this->step += 1;
+}
+
+// Slots in the state buffer, the slots of cells that died hold no cell until a daughter is put in them
+GLuint GpuSimulation::Count() const {
+    return this->N;
+}
+
+// Buffer holding the state after the last step, laid out as CellInstance. It changes on every step
+GLuint GpuSimulation::StateBuffer() const {
+    return this->stateBuffers[this->current];
+}
+
+double GpuSimulation::GetSimSeconds() const {
+    return this->simSeconds;
+}
+
+const static std::string stepVertexFilePath = SOURCE_DIRECTORY + "/shaders/simulate.vert.glsl";
+const static std::string wrapVertexFilePath = SOURCE_DIRECTORY + "/shaders/wraps.vert.glsl";
+const static std::string wrapGeometryFilePath = SOURCE_DIRECTORY + "/shaders/wraps.geom.glsl";
+
+GpuSimulation::GpuSimulation(const Population& population, uint64_t seed) : N(0), live(0), cellRadius(population.GetCellRadius()), capacity(0), step(0), simSeconds(population.GetSimSeconds()),
+  seed(seed), nextId(0), random(seed), stepProgram(stepVertexFilePath.c_str(), nullptr, { "nextMotion", "nextCycle", "nextRecord" }),
+  wrapProgram(wrapVertexFilePath.c_str(), wrapGeometryFilePath.c_str(), { "wrapIndex", "wrapMotion", "wrapCycle", "wrapRecord" }),
+  deltaSecondsUniform(stepProgram.GetUniform<GLfloat>("deltaSeconds")),
+  crowdingUniform(stepProgram.GetUniform<GLfloat>("crowding")), stepIndexUniform(stepProgram.GetUniform<GLuint>("stepIndex")),
+  stateVAOs(), stateBuffers(), current(0), eventSlots(), pending(0), events(), daughters(), emptySlots() {
+    this->Init(population);
+}
+
+void GpuSimulation::Terminate() {
+    GLCALL(glDeleteVertexArrays(2, this->stateVAOs));
+    GLCALL(glDeleteBuffers(2, this->stateBuffers));
+    for (EventSlot& slot : this->eventSlots) {
+        GLCALL(glDeleteBuffers(1, &slot.buffer));
+        GLCALL(glDeleteQueries(1, &slot.query));
+    }
+}
+
+GpuSimulation::~GpuSimulation() {
+    this->Terminate();
+}
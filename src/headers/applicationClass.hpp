@@ -2,6 +2,13 @@
 #include "../../include/glad/glad.h"
 #include "../../include/GLFW/glfw3.h"
 
+// Where the cells are stepped
+enum SimulationBackend {
+	cpuBackend, // Population, on the CPU
+	transformFeedbackBackend, // GpuSimulation, needs OpenGL 3.3
+	computeBackend // ComputeSimulation, needs OpenGL 4.3
+};
+
 class Application {
 private:
 	unsigned int width, height;
@@ -11,5 +18,5 @@ private:
 public:
 	Application(GLuint glMajorVersion, GLuint glMinorVersion, unsigned int width, unsigned int height);
 	~Application();
-	int Run();
+	int Run(SimulationBackend backend, bool analytic);
 };
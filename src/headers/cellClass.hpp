@@ -1,40 +1,82 @@
 # pragma once
 
 #include "../headers/shaderClass.hpp"
-#include "../headers/shaderClass.hpp"
+#include "../headers/streamBufferClass.hpp"
+#include "../core/headers/cellPhases.hpp"
+#include "../core/headers/populationClass.hpp"
 #include "../../include/glad/glad.h"
+#include <cstdint>
 #include <vector>
 
-// Used for the dimension param of Cells:GetPos method
-# define X 0
-# define Y 1
-# define R 2
-# define S 3
+// Uniform buffer binding point of the phase tables
+# define PHASE_TABLES_BINDING 0
+
+// Instance data of each cell, three texels of the instance buffer texture. The vertex shader
+// picks the image from the phase and works out the radius from the phase, progress and speed multiplier
+struct CellInstance {
+	GLfloat x, y; // Position of the cell
+	GLfloat vx, vy; // Velocity of the cell
+	GLfloat phaseProgress; // Seconds spent in the current phase
+	GLfloat speedMultiplier;
+	GLuint phase; // Current stage of the cycle, a CellPhases::Status
+	GLuint flags; // Bits GpuSimulation sets for a cell that divided or died in the last step, and for an empty slot
+	GLuint id[2]; // Low and high 32 bits of the ID of the cell, only the GPU simulations keep them
+	// Simulated time the state was taken at, the vertex shader moves the cell on from it to the time
+	// the cell is drawn at. States that are drawn a little past their own time take it as 0
+	GLfloat recordSeconds;
+	GLfloat padding;
+};
+
+// Per-phase tables the vertex shader works out the radius from, laid out as the
+// std140 PhaseTables uniform block
+struct PhaseTablesBlock {
+	GLfloat phases[CellPhases::count][4]; // Duration, radius at the start and at the end of each phase
+	GLfloat cellRadius; // Largest cell radius
+	GLfloat radiusSpeedCap;
+	GLfloat stepSeconds; // Seconds in each step of the population
+	GLfloat padding;
+};
 
+// Renders a population, it only reads the population state, or the cells of a GpuSimulation or ComputeSimulation.
+// Every cell is a quad drawn by one draw call without vertex attributes, the vertex
+// shader pulls the data of its cell from a buffer texture using gl_VertexID.
+// In the analytic mode each cell is drawn from a record of its state that is only uploaded
+// again when a step changes the cell in a way the vertex shader cannot work out itself
 class Cells {
-	GLuint N; // Number of cells
-	GLfloat r; // Largest cell radius
+	GLuint N; // Number of cells in the buffers
+	GLuint drawBuffer; // Buffer with the command to draw the cells when only the GPU knows their number, 0 otherwise
+	const Population& population;
 	Shader shaderProgram;	
-	std::vector<float> pos; // Position of each particle
-	std::vector<float> vel; // Velocity of each particle
-	// Multipies the speed that each cell goes through the cell cycle, > 2.0 = cancer cell
-	// The higher the speed multiplier, the more resistant the cell is to apoptosis
-	std::vector<float> speedMultiplier;
-	std::vector<float> statusDurationSeconds; // Duration in seconds in current stage of cycle
-	std::vector<GLfloat> verts; // Vertex data
-	std::vector<GLuint> indices; // Index data
-	bool duplicationOcured;
-	GLuint VAO, VBO, EBO, texture[8];
+	Uniform<GLint> phaseTexturesUniform; // Texture unit the texture array is bound to
+	Uniform<GLint> instancesUniform; // Texture unit the instance buffer texture is bound to
+	Uniform<GLint> instanceBaseUniform; // First texel of the instance data of this frame
+	Uniform<GLfloat> drawSecondsUniform; // Time the cells are drawn at, on the clock of CellInstance::recordSeconds
+	GLuint VAO, phaseTextures, instanceTexture, phaseTablesUBO;
+	unsigned int attachedGeneration; // Generation of the instance stream the instance texture views, 0 for none
+	GLint instanceBase; // First texel of the uploaded instance data
+	double uploadedSeconds; // Simulated time of the uploaded state, negative before the first upload
+	float drawSeconds; // Time the cells are drawn at, on the clock of CellInstance::recordSeconds
+	float stepSeconds; // Seconds in each step of the population
+	StreamBuffer instanceStream; // Instance data, written straight into the buffer after each step
+	bool analytic; // Whether the cells are drawn from their records
+	GLuint recordBuffer; // Record of each cell in the analytic mode, laid out as CellInstance
+	GLuint recordCapacity; // Records the record buffer has room for
+	bool recordsUploaded; // Whether the records were uploaded, the first upload writes all of them
+	uint32_t recordStep; // Step of the population the records are up to date with
+	std::vector<unsigned int> changedRecords; // Cells whose records are written in this update, in index order
+	std::vector<CellInstance> records; // Records written in this update
 
-	float& GetPos(unsigned int dimension, unsigned int index);
-	float& GetVel(unsigned int dimension, unsigned int index);
-	float& GetVerts(unsigned int dimension, unsigned int vertex, unsigned int index);
+	void AttachInstances(GLuint buffer);
 	void Init();
 	void Terminate();
 public:
 	void Draw();
-	void Update(float deltaSeconds);
-	void UpdateBufferData();
-	Cells(GLuint N, GLfloat r);
+	void EnableAnalyticMotion();
+	void UpdateRecords();
+	void UpdateBufferData(float aheadSeconds);
+	void UpdateBufferData(GLuint stateBuffer, GLuint count, float aheadSeconds);
+	void UpdateBufferDataIndirect(GLuint stateBuffer, GLuint drawBuffer, float aheadSeconds);
+	static void CopyCellData(const Population& population, CellInstance* instances);
+	Cells(const Population& population, float stepSeconds);
 	~Cells();
 };
@@ -0,0 +1,66 @@
+# pragma once
+
+#include "../headers/shaderClass.hpp"
+#include "../core/headers/populationClass.hpp"
+#include "../../include/glad/glad.h"
+#include <cstdint>
+#include <vector>
+
+// Threads in each work group of the compute shaders, has to match GROUP_SIZE in the shaders
+# define COMPUTE_GROUP_SIZE 256
+
+// Steps whose cell count can be waiting to be read back before a step waits for the GPU
+# define COUNT_SLOTS 3
+
+// Runs a whole population on the GPU with compute shaders, it needs OpenGL 4.3. The cells
+// live in two shader storage buffers laid out as CellInstance, with the ID of each cell in
+// its instance. Each step one pass moves the cells, runs their phase timers and rolls for
+// divisions and deaths, a prefix sum gives each cell the index its survivors go to, and
+// a scatter pass packs them into the other buffer. The cell count stays on the GPU, which
+// sizes the passes of the next step and the draw of the cells itself, and a copy of it is
+// read back a few steps later only to keep the buffers large enough.
+// Cells can draw straight from the state buffer. Cells do not push each other apart in this mode
+class ComputeSimulation {
+	// Cell count after one step, waiting to be read back
+	struct CountSlot {
+		GLuint buffer;
+		GLsync fence; // Signalled once the count is in the buffer
+	};
+
+	GLuint N; // Number of cells as of the last count read back
+	float cellRadius; // Largest cell radius, for the crowding
+	GLuint capacity; // Cells the buffers have room for, at least twice the cells before each step
+	uint32_t step;
+	double simSeconds;
+	uint64_t seed;
+	Shader stepProgram, scanProgram, scanAddProgram, scatterProgram, argumentsProgram;
+	Uniform<GLuint> stepIndexUniform, scanLevelUniform, scanAddLevelUniform, scatterStepIndexUniform, levelCountUniform;
+	Uniform<GLfloat> deltaSecondsUniform;
+	GLuint stateBuffers[2];
+	unsigned int current; // Buffer holding the state after the last step
+	GLuint flagsBuffer, offsetsBuffer, totalsBuffer;
+	GLuint argumentsBuffer; // Cell count, next ID and the sizes of the dispatches and the draw, kept by the GPU
+	std::vector<GLuint> sumBuffers; // Totals of the work groups at each level of the prefix sum
+	GLint maxGroups; // Most work groups in one dimension of a dispatch
+	CountSlot countSlots[COUNT_SLOTS]; // Used as a ring, the slot of each step is its index modulo COUNT_SLOTS
+	unsigned int pending; // Steps whose count has not been read back, the oldest first
+
+	void Allocate(GLuint capacity);
+	void Dispatch(unsigned int level);
+	void Scan(GLuint buffer, unsigned int level);
+	void WriteArguments();
+	void ReadCounts(bool wait);
+	void Init(const Population& population);
+	void Terminate();
+public:
+	void Update(float deltaSeconds);
+	GLuint Count() const;
+	GLuint StateBuffer() const;
+	GLuint DrawBuffer() const;
+	double GetSimSeconds() const;
+	static bool Supported();
+	ComputeSimulation(const Population& population, uint64_t seed);
+	ComputeSimulation(const ComputeSimulation&) = delete;
+	ComputeSimulation& operator=(const ComputeSimulation&) = delete;
+	~ComputeSimulation();
+};
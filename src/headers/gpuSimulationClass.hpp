@@ -0,0 +1,78 @@
+# pragma once
+
+#include "../headers/cellClass.hpp"
+#include "../headers/shaderClass.hpp"
+#include "../core/headers/counterRandomClass.hpp"
+#include "../core/headers/populationClass.hpp"
+#include "../../include/glad/glad.h"
+#include <cstdint>
+#include <vector>
+
+// Bits of CellInstance::flags in the state of GpuSimulation
+# define CELL_DIVIDED 1u // The cell finished its cycle in the last step
+# define CELL_DIED 2u // The cell died in the last step
+# define CELL_EMPTY 4u // The slot holds no cell, it is not stepped or drawn
+
+// Steps whose events can be waiting to be read back at once
+# define EVENT_SLOTS 4
+
+// A cell that finished its cycle or died in the last step, as the wrap pass captures it
+struct WrapEvent {
+	GLuint index; // Index of the cell in the state buffer
+	CellInstance state; // State of the cell after the step
+};
+
+// Runs the motion, the bounces off the walls, the phase timers and the deaths of a population
+// on the GPU. Each step a vertex shader reads every cell from one of two state buffers and
+// transform feedback writes the stepped cells to the other. Cells that die leave an empty slot
+// behind, so no cell changes index on the GPU. A second pass packs the cells that divided or died
+// into an event buffer. The CPU reads the events back once the GPU has written them, without
+// waiting for it, and adds the daughters, in the empty slots first. Daughters read back late are
+// stepped on the CPU through the steps they missed. The state is laid out as CellInstance, so
+// Cells can draw straight from it. Cells do not push each other apart in this mode
+class GpuSimulation {
+	// Events of one step, waiting to be read back
+	struct EventSlot {
+		GLuint buffer, query;
+		GLuint capacity; // Events the buffer has room for
+		uint32_t step; // Step the events were written in
+		float deltaSeconds; // Length of that step
+		float crowding; // Crowding the deaths of that step were rolled with
+	};
+
+	GLuint N; // Number of slots in use, some can be empty
+	GLuint live; // Cells in the slots as of the last events read back
+	float cellRadius; // Largest cell radius, for the crowding
+	GLuint capacity; // Cells the buffers have room for
+	uint32_t step;
+	double simSeconds;
+	uint64_t seed;
+	uint64_t nextId; // ID given to the next cell that is created
+	CounterRandom random;
+	Shader stepProgram, wrapProgram;
+	Uniform<GLfloat> deltaSecondsUniform, crowdingUniform;
+	Uniform<GLuint> stepIndexUniform;
+	GLuint stateVAOs[2], stateBuffers[2]; // Each VAO reads the cells of the buffer with its index
+	unsigned int current; // Buffer holding the state after the last step
+	EventSlot eventSlots[EVENT_SLOTS]; // Used as a ring, the slot of each step is its index modulo EVENT_SLOTS
+	unsigned int pending; // Steps whose events have not been read back, the oldest first
+	std::vector<WrapEvent> events; // Events being read back
+	std::vector<CellInstance> daughters; // Daughters being added
+	std::vector<GLuint> emptySlots; // Slots of the cells that died, filled by the next daughters
+
+	void Allocate(GLuint capacity);
+	void Init(const Population& population);
+	void Terminate();
+	bool CatchUp(CellInstance& cell, uint32_t fromStep) const;
+	void ApplyEvents(const EventSlot& slot, GLuint count);
+	void ReadEvents(bool wait);
+public:
+	void Update(float deltaSeconds);
+	GLuint Count() const;
+	GLuint StateBuffer() const;
+	double GetSimSeconds() const;
+	GpuSimulation(const Population& population, uint64_t seed);
+	GpuSimulation(const GpuSimulation&) = delete;
+	GpuSimulation& operator=(const GpuSimulation&) = delete;
+	~GpuSimulation();
+};
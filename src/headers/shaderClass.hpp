@@ -1,8 +1,11 @@
 #pragma once
 
 #include "../../include/glad/glad.h"
+#include "openGLdebug.hpp"
 #include <exception>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 // Class for thrownig file releated exceptions
 class FileError : public std::exception {
@@ -15,12 +18,50 @@ public:
 // Parses file into a string
 std::string parse_file(const char* filepath);
 
+// Set a uniform of the program in use, one overload for each type a Uniform can have
+inline void SetUniformValue(GLint location, GLint value) { GLCALL(glUniform1i(location, value)); }
+inline void SetUniformValue(GLint location, GLuint value) { GLCALL(glUniform1ui(location, value)); }
+inline void SetUniformValue(GLint location, GLfloat value) { GLCALL(glUniform1f(location, value)); }
+
+// Handle to a uniform of a shader program, with its location looked up once.
+// It keeps the last value it set, so setting the same value again makes no GL call.
+// The program of the uniform has to be in use when it is set
+template <typename T>
+class Uniform {
+    GLint location; // -1 for uniforms the program does not use, GL ignores those
+    T value;
+    bool set; // Whether value has been sent to GL yet
+public:
+    void Set(T value) {
+        if (this->set && this->value == value) {
+            return;
+        }
+        SetUniformValue(this->location, value);
+        this->value = value;
+        this->set = true;
+    }
+
+    Uniform(GLint location) : location(location), value(), set(false) {}
+};
+
 // Class for encapsulating shaders
 class Shader {
+    std::unordered_map<std::string, GLint> uniformLocations; // Location of each active uniform, found after linking
+    void Link(const GLuint* shaders, unsigned int count);
+    void FindUniforms();
     void Delete();
 public:
     GLuint ID;
     Shader(const char* vertexFilePath, const char* fragmentFilePath);
+    Shader(const char* vertexFilePath, const char* geometryFilePath, const std::vector<const char*>& feedbackVaryings);
+    Shader(const std::vector<const char*>& computeFilePaths);
     ~Shader();
     void Activate();
+    GLint GetUniformLocation(const char* name) const;
+    void BindUniformBlock(const char* name, GLuint binding);
+
+    template <typename T>
+    Uniform<T> GetUniform(const char* name) const {
+        return Uniform<T>(this->GetUniformLocation(name));
+    }
 };
@@ -0,0 +1,23 @@
+# pragma once
+
+#include "../../include/glad/glad.h"
+
+// Number of texture units the cache tracks, binds on higher units always reach GL
+# define CACHED_TEXTURE_UNITS 16
+
+// Remembers the GL state set through it, so setting the state that is already
+// current makes no GL call. State changed without going through the cache makes
+// it out of date, Reset makes the next call of each kind reach GL again
+class StateCache {
+	static GLuint program; // Program in use
+	static GLenum activeUnit; // Active texture unit, as an offset from GL_TEXTURE0
+	static GLuint textures[CACHED_TEXTURE_UNITS]; // Texture bound on each unit
+	static GLenum targets[CACHED_TEXTURE_UNITS]; // Target each texture is bound to
+public:
+	static void UseProgram(GLuint program);
+	static void ActiveTexture(GLenum unit);
+	static void BindTexture(GLenum unit, GLenum target, GLuint texture);
+	static void ForgetProgram(GLuint program);
+	static void ForgetTexture(GLuint texture);
+	static void Reset();
+};
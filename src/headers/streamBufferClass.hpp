@@ -0,0 +1,34 @@
+# pragma once
+
+#include "../../include/glad/glad.h"
+
+// Number of regions in the ring, the CPU writes one while the GPU may still read the other two
+# define STREAM_REGIONS 3
+
+// Vertex buffer that is written again every frame. When the driver has buffer storage
+// (GL 4.4 or GL_ARB_buffer_storage) the buffer is mapped once and used as a ring of
+// regions, each guarded by a fence, so writing never waits for or copies through the
+// driver. On plain GL 3.3 the buffer is orphaned and mapped again every frame
+class StreamBuffer {
+	GLuint ID;
+	bool persistent; // Whether the buffer is a persistently mapped ring
+	GLsizeiptr regionSize; // Bytes in each region, it at least doubles when it grows
+	unsigned int region; // Region written last
+	GLsync fences[STREAM_REGIONS]; // Signalled when the GPU has finished reading each region
+	char* mapped; // Start of the ring while it is mapped
+	unsigned int generation; // Counts the allocations, GL can give a new buffer the name of the old one
+
+	void Allocate(GLsizeiptr regionSize);
+	void Delete();
+public:
+	void* Map(GLsizeiptr size);
+	GLintptr Unmap();
+	void Fence();
+	GLuint Buffer() const;
+	unsigned int Generation() const;
+	bool Persistent() const;
+	StreamBuffer();
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+	~StreamBuffer();
+};
@@ -1,14 +1,34 @@
 #include "headers/applicationClass.hpp"
+#include <cstring>
 
-int main() {
+// Pass --gpu to step the cells on the GPU with transform feedback,
+// or --compute to step them with compute shaders when OpenGL 4.3 is available.
+// Pass --analytic to step them on the CPU without pushing, and have the GPU move
+// them between the uploads of the cells that divide or die
+int main(int argc, char** argv) {
 	unsigned int
 	height = 1000,
 	width = 1000,
 	glMinorVersion = 3,
 	glMajorVersion = 3;
 
+	SimulationBackend backend = cpuBackend;
+	bool analytic = false;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--gpu") == 0) {
+			backend = transformFeedbackBackend;
+		}
+		else if (std::strcmp(argv[i], "--compute") == 0) {
+			backend = computeBackend;
+			glMajorVersion = 4;
+		}
+		else if (std::strcmp(argv[i], "--analytic") == 0) {
+			analytic = true;
+		}
+	}
+
 	Application app(glMajorVersion, glMinorVersion, height, width);
-	int status = app.Run();
+	int status = app.Run(backend, analytic);
 
 	return status;
 }
@@ -1,11 +1,14 @@
 #include "headers/openGLdebug.hpp"
 #include "../include/glad/glad.h"
 #include "headers/shaderClass.hpp"
+#include "headers/stateCacheClass.hpp"
+#include <algorithm>
 #include <cstdio>
 #include <exception>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <vector>
 
 // Constructor takes the message and what() spits out the message
 FileError::FileError(const char* message) : message(message) {}
@@ -39,33 +42,20 @@ std::string parse_file(const char *filepath) {
 }
 
 
-// Create the shaders from the path of the shader files
-Shader::Shader(const char* vertexFilePath, const char* fragmentFilePath) {
-    // Parse shaders into strings
-    std::string vertexCode = parse_file(vertexFilePath);
-    std::string fragmentCode = parse_file(fragmentFilePath);
-
-    const char* vertexSource = vertexCode.c_str();
-    const char* fragmentSource = fragmentCode.c_str();
-    
-    //  Compile shaders and check compilation status 
+// Compile one shader from its source code, typeName names the stage in the error message
+static GLuint CompileShader(GLenum type, const std::string& code, const char* typeName) {
+    const char* source = code.c_str();
 
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    GLCALL(glShaderSource(vertexShader, 1, &vertexSource, NULL));
-    GLCALL(glCompileShader(vertexShader));
-    CHECK_SHADER_COMPILE_STATUS(vertexShader, "Vertex");
-
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-
-    GLCALL(glShaderSource(fragmentShader, 1, &fragmentSource, NULL));
-    GLCALL(glCompileShader(fragmentShader));
-    CHECK_SHADER_COMPILE_STATUS(fragmentShader, "Fragment");
-
-    //  Create shader program and attach shaders 
+    GLuint shader;
+    GLCALL(shader = glCreateShader(type));
+    GLCALL(glShaderSource(shader, 1, &source, NULL));
+    GLCALL(glCompileShader(shader));
+    CHECK_SHADER_COMPILE_STATUS(shader, typeName);
+    return shader;
+}
 
-    ID = glCreateProgram();
-    GLCALL(glAttachShader(ID, vertexShader));
-    GLCALL(glAttachShader(ID, fragmentShader));
+// Link the program and delete the shaders attached to it
+void Shader::Link(const GLuint* shaders, unsigned int count) {
     GLCALL(glLinkProgram(ID));
 
     // Check success of linking program
@@ -80,15 +70,119 @@ Shader::Shader(const char* vertexFilePath, const char* fragmentFilePath) {
     }
 
     // Delete shaders 
-    GLCALL(glDeleteShader(vertexShader));
-    GLCALL(glDeleteShader(fragmentShader));
+    for (unsigned int i = 0; i < count; ++i) {
+        GLCALL(glDeleteShader(shaders[i]));
+    }
+
+    this->FindUniforms();
+}
+
+// Look up the location of every active uniform once the program is linked. An array is
+// listed by its first element, it can also be found by the name without the [0]
+void Shader::FindUniforms() {
+    GLint uniformCount, maxLength;
+    GLCALL(glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &uniformCount));
+    GLCALL(glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength));
+
+    std::vector<GLchar> name(std::max(maxLength, 1));
+    for (GLint i = 0; i < uniformCount; ++i) {
+        GLsizei length;
+        GLint size;
+        GLenum type;
+        GLCALL(glGetActiveUniform(ID, i, name.size(), &length, &size, &type, name.data()));
+
+        // Uniforms in blocks have no location, they are set through their buffer
+        GLint location;
+        GLCALL(location = glGetUniformLocation(ID, name.data()));
+        if (location < 0) {
+            continue;
+        }
+
+        std::string uniformName(name.data(), length);
+        this->uniformLocations[uniformName] = location;
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+            this->uniformLocations[uniformName.substr(0, uniformName.size() - 3)] = location;
+        }
+    }
 }
 
+// Create the shaders from the path of the shader files
+Shader::Shader(const char* vertexFilePath, const char* fragmentFilePath) {
+    //  Compile shaders and check compilation status 
+    GLuint shaders[2] = {
+        CompileShader(GL_VERTEX_SHADER, parse_file(vertexFilePath), "Vertex"),
+        CompileShader(GL_FRAGMENT_SHADER, parse_file(fragmentFilePath), "Fragment")
+    };
+
+    //  Create shader program and attach shaders 
+    GLCALL(ID = glCreateProgram());
+    for (GLuint shader : shaders) {
+        GLCALL(glAttachShader(ID, shader));
+    }
+    this->Link(shaders, 2);
+}
+
+// Create a program without a fragment shader that writes the varyings, in order and
+// interleaved, to the transform feedback buffer. The geometry shader can be nullptr
+Shader::Shader(const char* vertexFilePath, const char* geometryFilePath, const std::vector<const char*>& feedbackVaryings) {
+    GLuint shaders[2];
+    unsigned int count = 0;
+    shaders[count++] = CompileShader(GL_VERTEX_SHADER, parse_file(vertexFilePath), "Vertex");
+    if (geometryFilePath) {
+        shaders[count++] = CompileShader(GL_GEOMETRY_SHADER, parse_file(geometryFilePath), "Geometry");
+    }
+
+    GLCALL(ID = glCreateProgram());
+    for (unsigned int i = 0; i < count; ++i) {
+        GLCALL(glAttachShader(ID, shaders[i]));
+    }
+
+    // The varyings have to be chosen before the program is linked
+    GLCALL(glTransformFeedbackVaryings(ID, feedbackVaryings.size(), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS));
+    this->Link(shaders, count);
+}
+
+// Create a compute program from the files joined in order, so only the first
+// one has the #version line and the later ones can use what it declares
+Shader::Shader(const std::vector<const char*>& computeFilePaths) {
+    std::string code;
+    for (const char* filePath : computeFilePaths) {
+        code += parse_file(filePath);
+        code += "\n";
+    }
+    GLuint shader = CompileShader(GL_COMPUTE_SHADER, code, "Compute");
+
+    GLCALL(ID = glCreateProgram());
+    GLCALL(glAttachShader(ID, shader));
+    this->Link(&shader, 1);
+}
+
+// Use the program, nothing is done if it is already in use
 void Shader::Activate() {
-    GLCALL(glUseProgram(ID));
+    StateCache::UseProgram(ID);
+}
+
+// Location of a uniform found when the program was linked, -1 for uniforms the program
+// does not use so setting them is ignored by GL
+GLint Shader::GetUniformLocation(const char* name) const {
+    auto found = this->uniformLocations.find(name);
+    if (found == this->uniformLocations.end()) {
+        return -1;
+    }
+    return found->second;
+}
+
+// Read the uniform block from the buffer bound to the binding point, blocks the program does not use are skipped
+void Shader::BindUniformBlock(const char* name, GLuint binding) {
+    GLuint index;
+    GLCALL(index = glGetUniformBlockIndex(ID, name));
+    if (index != GL_INVALID_INDEX) {
+        GLCALL(glUniformBlockBinding(ID, index, binding));
+    }
 }
 
 void Shader::Delete() {
+    StateCache::ForgetProgram(ID);
     GLCALL(glDeleteProgram(ID));
 }
 
@@ -0,0 +1,49 @@
+#version 430 core
+
+// Fold the totals of the last step into the arguments and size every pass of the next
+// step and the draw of the cells from the new cell count, so the count never has to be
+// known on the CPU. Runs on a single thread
+#define GROUP_SIZE 256
+
+layout (local_size_x = 1) in;
+
+// Cells and daughters the last step left
+layout (std430, binding = 4) buffer Totals {
+    uvec2 totals;
+};
+
+// Arguments the GPU keeps for itself between steps, laid out as ComputeSimulation expects
+layout (std430, binding = 5) buffer Arguments {
+    uvec4 drawCommand; // Vertices, instances, first vertex and base instance of the draw of the cells
+    uint cellCount;
+    uint unused;
+    uvec2 nextId; // ID given to the next daughter, low and high 32 bits
+    uvec4 levels[]; // Values, then work groups in x, y and z of each level of the prefix sum
+};
+
+// Levels of the prefix sum, and most work groups in one dimension of a dispatch
+uniform uint levelCount;
+uniform uint maxGroups;
+
+void main() {
+    // The daughters are cleared once they are counted, so running again does not count them twice
+    cellCount = totals.x;
+    uint carry;
+    nextId.x = uaddCarry(nextId.x, totals.y, carry);
+    nextId.y += carry;
+    totals.y = 0u;
+
+    // Two triangles for every cell
+    drawCommand = uvec4(6u * cellCount, 1u, 0u, 0u);
+
+    // Each level of the prefix sum scans the group totals of the level before, the work groups
+    // go on to a second dimension when there are more than fit in one
+    uint count = cellCount;
+    for (uint level = 0u; level < levelCount; ++level) {
+        uint groups = (count + GROUP_SIZE - 1u) / GROUP_SIZE;
+        uint columns = min(groups, maxGroups);
+        uint rows = columns > 0u ? (groups + columns - 1u) / columns : 0u;
+        levels[level] = uvec4(count, columns, rows, 1u);
+        count = groups;
+    }
+}
@@ -1,15 +1,83 @@
 #version 330 core
 
-layout (location = 0) in vec2 aPos;
-layout (location = 1) in vec3 offset;
-layout (location = 2) in float radius;
-layout (location = 3) in float status;
+// Instance data of every cell, three texels per cell: x, y, x velocity, y velocity, then phase
+// progress, speed multiplier, phase and flags, then the ID, the time the state was taken at and
+// one unused value. The floats are stored in the bits of the texels
+uniform usamplerBuffer instances;
+uniform int instanceBase;
+
+// Time to draw the cells at, on the clock of the times the states were taken at
+uniform float drawSeconds;
+
+// Per-phase tables, filled once from CellPhases
+layout (std140) uniform PhaseTables {
+    vec4 phases[7]; // x duration, y radius at the start, z radius at the end of each phase
+    float cellRadius; // Largest cell radius
+    float radiusSpeedCap; // Speed multiplier past which faster cells get no smaller
+    float stepSeconds; // Seconds in each step of the population
+};
+
+// Corners of the two triangles of a quad, x position in quad, y position in quad
+const vec2 corners[6] = vec2[6](
+    vec2(-1.0,  1.0), vec2(1.0,  1.0), vec2(1.0, -1.0),
+    vec2(-1.0,  1.0), vec2(1.0, -1.0), vec2(-1.0, -1.0)
+);
 
 out vec2 TextCoord;
-out float Status;
+flat out uint Phase;
+
+// Fold a position that went past the walls back into [-1, 1], as if it bounced off them
+vec2 Fold(vec2 position) {
+    vec2 wrapped = mod(position + 1.0, 4.0);
+    return 1.0 - abs(wrapped - 2.0);
+}
 
 void main() {
-    gl_Position = vec4(aPos.xy * radius + offset.xy, 0.0, 1.0);
+    vec2 aPos = corners[gl_VertexID % 6];
+    int cell = instanceBase + 3 * (gl_VertexID / 6);
+    uvec4 motion = texelFetch(instances, cell);
+    uvec4 cycle = texelFetch(instances, cell + 1);
+    uvec4 record = texelFetch(instances, cell + 2);
+    float elapsed = drawSeconds - uintBitsToFloat(record.z);
+
+    // Bit 2 of the flags marks a slot of GpuSimulation that holds no cell, its quad is collapsed to a point
+    if ((cycle.w & 4u) != 0u) {
+        gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+        TextCoord = vec2(0.0);
+        Phase = 0u;
+        return;
+    }
+
+    // Move the cell along its velocity, bouncing off the walls
+    vec2 position = uintBitsToFloat(motion.xy);
+    vec2 velocity = uintBitsToFloat(motion.zw);
+    vec2 offset = Fold(position + velocity * elapsed);
+
+    float progress = uintBitsToFloat(cycle.x);
+    float speedMultiplier = uintBitsToFloat(cycle.y);
+    uint phase = cycle.z;
+
+    // Take the cell through its phases the way the population steps it: the progress grows a step
+    // at a time, and in the first step it reaches the end of the phase the next phase starts from 0.
+    // A cell at the end of the last phase waits there until its division is uploaded
+    float phaseSeconds = elapsed;
+    float progressPerStep = speedMultiplier * stepSeconds;
+    while (phase < 6u) {
+        float steps = max(ceil((phases[phase].x - progress) / progressPerStep), 1.0);
+        if (steps * stepSeconds > phaseSeconds) {
+            break;
+        }
+        phaseSeconds -= steps * stepSeconds;
+        phase += 1u;
+        progress = 0.0;
+    }
+
+    // Grow the cell through its phase, faster cells are smaller. The progress goes on to the end of the phase
+    vec4 table = phases[phase];
+    progress = min(progress + speedMultiplier * phaseSeconds, table.x);
+    float radius = mix(table.y, table.z, progress / table.x) * (cellRadius / min(speedMultiplier, radiusSpeedCap));
+
+    gl_Position = vec4(aPos.xy * radius + offset, 0.0, 1.0);
     TextCoord = (aPos + 1) / 2.0;
-    Status = status;
+    Phase = phase;
 }
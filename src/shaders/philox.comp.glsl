@@ -0,0 +1,57 @@
+#version 430 core
+
+// Shared head of the compute shaders that draw random numbers, the shader that uses it is
+// joined after it. Draws the same numbers as CounterRandom on the CPU
+
+// Threads in each work group, has to match COMPUTE_GROUP_SIZE
+#define GROUP_SIZE 256
+
+// Streams of CounterRandom
+#define DIVISION_STREAM 2u
+#define DEATH_STREAM 3u
+
+// State of one cell, laid out as a CellInstance
+struct Cell {
+    vec4 motion; // x, y, x velocity, y velocity
+    float phaseProgress; // Seconds spent in the current phase
+    float speedMultiplier;
+    uint phase;
+    uint flags; // Not used by the compute shaders
+    uvec2 id; // Low and high 32 bits of the ID
+    vec2 padding;
+};
+
+// Seed of the random numbers, low and high 32 bits
+uniform uvec2 randomKey;
+
+// Arguments the GPU keeps for itself between steps, laid out as ComputeSimulation expects
+layout (std430, binding = 5) readonly buffer Arguments {
+    uvec4 drawCommand; // Vertices, instances, first vertex and base instance of the draw of the cells
+    uint cellCount;
+    uint unused;
+    uvec2 nextId; // ID given to the next daughter, low and high 32 bits
+    uvec4 levels[]; // Values, then work groups in x, y and z of each level of the prefix sum
+};
+
+// Index of the cell of this thread, the work groups can be laid out in two dimensions
+// as there is a limit on the groups in each dimension
+uint CellIndex() {
+    uint group = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    return group * GROUP_SIZE + gl_LocalInvocationID.x;
+}
+
+// 4 uniform random floats in [0, 1) for the counter, Philox 4x32-10
+vec4 Uniform(uvec2 id, uint step, uint stream) {
+    uvec4 counter = uvec4(id, step, stream);
+    uvec2 roundKey = randomKey;
+    for (int r = 0; r < 10; ++r) {
+        uint high0, low0, high1, low1;
+        umulExtended(0xD2511F53u, counter.x, high0, low0);
+        umulExtended(0xCD9E8D57u, counter.z, high1, low1);
+        counter = uvec4(high1 ^ counter.y ^ roundKey.x, low1, high0 ^ counter.w ^ roundKey.y, low0);
+        roundKey += uvec2(0x9E3779B9u, 0xBB67AE85u);
+    }
+
+    // Use the top 24 bits so every value is exactly representable
+    return vec4(counter >> 8u) * (1.0 / 16777216.0);
+}
@@ -0,0 +1,82 @@
+#version 430 core
+
+// Exclusive prefix sum of the values within each work group of GROUP_SIZE values,
+// the total of each group is written to sums to be scanned in turn. Each group runs
+// the work-efficient scan of Blelloch: a pass up a tree of partial sums and a pass
+// back down it, about 2 * GROUP_SIZE adds in all
+#define GROUP_SIZE 256
+
+layout (local_size_x = GROUP_SIZE) in;
+
+layout (std430, binding = 0) buffer Values {
+    uvec2 values[];
+};
+
+layout (std430, binding = 1) writeonly buffer Sums {
+    uvec2 sums[];
+};
+
+// Arguments the GPU keeps for itself between steps, laid out as ComputeSimulation expects
+layout (std430, binding = 5) readonly buffer Arguments {
+    uvec4 drawCommand; // Vertices, instances, first vertex and base instance of the draw of the cells
+    uint cellCount;
+    uint unused;
+    uvec2 nextId; // ID given to the next daughter, low and high 32 bits
+    uvec4 levels[]; // Values, then work groups in x, y and z of each level of the prefix sum
+};
+
+// Level of the prefix sum this pass scans, its number of values is in the arguments
+uniform uint level;
+
+shared uvec2 partial[GROUP_SIZE];
+
+void main() {
+    uint count = levels[level].x;
+    uint group = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint lane = gl_LocalInvocationID.x;
+    uint i = group * GROUP_SIZE + lane;
+
+    // Every thread takes part in the barriers, the values past the end count as 0
+    partial[lane] = i < count ? values[i] : uvec2(0u);
+
+    // Up the tree, each round adds the sum of every left half into its right half
+    for (uint stride = 1u; stride < GROUP_SIZE; stride <<= 1) {
+        memoryBarrierShared();
+        barrier();
+        uint right = (lane + 1u) * stride * 2u - 1u;
+        if (right < GROUP_SIZE) {
+            partial[right] += partial[right - stride];
+        }
+    }
+    memoryBarrierShared();
+    barrier();
+
+    // The root holds the total of the group, it is replaced by the 0 the exclusive sum starts from
+    uvec2 total = partial[GROUP_SIZE - 1u];
+    memoryBarrierShared();
+    barrier();
+    if (lane == 0u) {
+        partial[GROUP_SIZE - 1u] = uvec2(0u);
+    }
+
+    // Back down the tree, each left half takes the sum before its node and each right half adds the left half to it
+    for (uint stride = GROUP_SIZE / 2u; stride > 0u; stride >>= 1) {
+        memoryBarrierShared();
+        barrier();
+        uint right = (lane + 1u) * stride * 2u - 1u;
+        if (right < GROUP_SIZE) {
+            uvec2 left = partial[right - stride];
+            partial[right - stride] = partial[right];
+            partial[right] += left;
+        }
+    }
+    memoryBarrierShared();
+    barrier();
+
+    if (i < count) {
+        values[i] = partial[lane];
+    }
+    if (lane == 0u && group * GROUP_SIZE < count) {
+        sums[group] = total;
+    }
+}
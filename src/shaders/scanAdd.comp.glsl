@@ -0,0 +1,35 @@
+#version 430 core
+
+// Add the scanned total of the groups before each work group to its values,
+// finishing a prefix sum over more values than one group holds
+#define GROUP_SIZE 256
+
+layout (local_size_x = GROUP_SIZE) in;
+
+layout (std430, binding = 0) buffer Values {
+    uvec2 values[];
+};
+
+layout (std430, binding = 1) readonly buffer Sums {
+    uvec2 sums[];
+};
+
+// Arguments the GPU keeps for itself between steps, laid out as ComputeSimulation expects
+layout (std430, binding = 5) readonly buffer Arguments {
+    uvec4 drawCommand; // Vertices, instances, first vertex and base instance of the draw of the cells
+    uint cellCount;
+    uint unused;
+    uvec2 nextId; // ID given to the next daughter, low and high 32 bits
+    uvec4 levels[]; // Values, then work groups in x, y and z of each level of the prefix sum
+};
+
+// Level of the prefix sum this pass adds to, its number of values is in the arguments
+uniform uint level;
+
+void main() {
+    uint group = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint i = group * GROUP_SIZE + gl_LocalInvocationID.x;
+    if (i < levels[level].x) {
+        values[i] += sums[group];
+    }
+}
@@ -0,0 +1,71 @@
+// Joined after philox.comp.glsl
+
+// Write the cells left by each cell to the next state buffer at its offset, the cell
+// unless it died followed by its daughter if it divided and the daughter lived. Dead cells
+// are dropped and the order of the cells is kept, each daughter comes right after its parent
+layout (local_size_x = GROUP_SIZE) in;
+
+layout (std430, binding = 0) readonly buffer State {
+    Cell cells[];
+};
+
+layout (std430, binding = 1) writeonly buffer NextState {
+    Cell nextCells[];
+};
+
+layout (std430, binding = 2) readonly buffer Flags {
+    uint flags[];
+};
+
+// Cells, and daughters, left by the cells before each cell
+layout (std430, binding = 3) readonly buffer Offsets {
+    uvec2 offsets[];
+};
+
+// Cells and daughters in the next state, folded into the arguments after the step
+layout (std430, binding = 4) writeonly buffer Totals {
+    uvec2 totals;
+};
+
+uniform uint stepIndex;
+
+void main() {
+    uint i = CellIndex();
+    if (i >= cellCount) {
+        return;
+    }
+    Cell cell = cells[i];
+    bool divides = (flags[i] & 1u) != 0u;
+    bool dies = (flags[i] & 2u) != 0u;
+    bool born = divides && (flags[i] & 4u) == 0u;
+    uvec2 offset = offsets[i];
+
+    uint target = offset.x;
+    if (divides) {
+        // Duplicate the position, the phase and the progress, and flip the velocity
+        Cell daughter = cell;
+        daughter.motion.zw = -cell.motion.zw;
+
+        // Daughters are numbered in index order, carrying into the high bits of the ID
+        uint carry;
+        daughter.id.x = uaddCarry(nextId.x, offset.y, carry);
+        daughter.id.y = nextId.y + carry;
+
+        // Modify the speedMultiplier values by a random amount in [-25%, 50%]
+        vec4 randomNumbers = Uniform(cell.id, stepIndex, DIVISION_STREAM);
+        daughter.speedMultiplier = cell.speedMultiplier * (1.0 + (randomNumbers.x * 1.5 - 0.5) * 0.5);
+        cell.speedMultiplier *= 1.0 + (randomNumbers.y * 1.5 - 0.5) * 0.5;
+
+        // A daughter that died in the step it was made in was not counted
+        if (born) {
+            nextCells[target + uint(!dies)] = daughter;
+        }
+    }
+    if (!dies) {
+        nextCells[target] = cell;
+    }
+
+    if (i == cellCount - 1u) {
+        totals = offset + uvec2(uint(!dies) + uint(born), uint(born));
+    }
+}
@@ -0,0 +1,115 @@
+#version 330 core
+
+// State of one cell, laid out as a CellInstance: x, y, x velocity, y velocity, then phase
+// progress, speed multiplier, phase and flags, then the ID, the time the state was taken at
+// and one unused value. The floats of the last two are read as their bits
+layout (location = 0) in vec4 motion;
+layout (location = 1) in uvec4 cycle;
+layout (location = 2) in uvec4 record;
+
+// Bits of the flags: the cell finished its cycle in this step, the cell died in this step,
+// and the slot holds no cell. They match the flags of GpuSimulation
+#define DIVIDED 1u
+#define DIED 2u
+#define EMPTY 4u
+
+// Stream of CounterRandom the deaths are rolled from
+#define DEATH_STREAM 3u
+
+uniform float deltaSeconds;
+uniform uint stepIndex;
+
+// Fraction of the dish the cells cover, the death hazards are scaled by it
+uniform float crowding;
+
+// Seed of the random numbers, low and high 32 bits
+uniform uvec2 randomKey;
+
+// Per-phase tables
+uniform float durationSeconds[7];
+uniform float deathHazardPerSecond[7];
+
+// State of the cell after the step, captured by transform feedback
+out vec4 nextMotion;
+flat out uvec4 nextCycle;
+flat out uvec4 nextRecord;
+
+// Fold a position that went past the walls back into [-1, 1], as if it bounced off them, like
+// SimdKernels::Fold. The velocity is flipped on the folds that send the cell back the other way
+vec2 Fold(vec2 position, inout vec2 velocity) {
+    vec2 shifted = position + 1.0;
+    vec2 wrapped = shifted - 4.0 * floor(shifted * 0.25);
+    velocity = mix(velocity, -velocity, greaterThan(wrapped, vec2(2.0)));
+    return 1.0 - abs(wrapped - 2.0);
+}
+
+// High and low 32 bits of the 64 bit product of a and b. GLSL 3.30 has no umulExtended,
+// so the high bits are put together from the products of the 16 bit halves
+uvec2 MultiplyExtended(uint a, uint b) {
+    uint aLow = a & 0xFFFFu, aHigh = a >> 16u;
+    uint bLow = b & 0xFFFFu, bHigh = b >> 16u;
+    uint lowLow = aLow * bLow;
+    uint lowHigh = aLow * bHigh;
+    uint highLow = aHigh * bLow;
+
+    // Bits 16 to 31 of the product, with the carry out of them in the top bits
+    uint middle = (lowLow >> 16u) + (lowHigh & 0xFFFFu) + (highLow & 0xFFFFu);
+    uint high = aHigh * bHigh + (lowHigh >> 16u) + (highLow >> 16u) + (middle >> 16u);
+    return uvec2(high, a * b);
+}
+
+// 4 uniform random floats in [0, 1) for the counter, Philox 4x32-10. Draws the same numbers as CounterRandom on the CPU
+vec4 Uniform(uvec2 id, uint step, uint stream) {
+    uvec4 counter = uvec4(id, step, stream);
+    uvec2 roundKey = randomKey;
+    for (int r = 0; r < 10; ++r) {
+        uvec2 product0 = MultiplyExtended(0xD2511F53u, counter.x);
+        uvec2 product1 = MultiplyExtended(0xCD9E8D57u, counter.z);
+        counter = uvec4(product1.x ^ counter.y ^ roundKey.x, product1.y, product0.x ^ counter.w ^ roundKey.y, product0.y);
+        roundKey += uvec2(0x9E3779B9u, 0xBB67AE85u);
+    }
+
+    // Use the top 24 bits so every value is exactly representable
+    return vec4(counter >> 8u) * (1.0 / 16777216.0);
+}
+
+void main() {
+    // A slot stays empty once its cell has died, until the CPU puts a daughter in it
+    if ((cycle.w & (DIED | EMPTY)) != 0u) {
+        nextMotion = motion;
+        nextCycle = uvec4(cycle.xyz, EMPTY);
+        nextRecord = record;
+        return;
+    }
+
+    // Update the progress in the phase
+    float speedMultiplier = uintBitsToFloat(cycle.y);
+    uint phase = cycle.z;
+    float progress = uintBitsToFloat(cycle.x) + speedMultiplier * deltaSeconds;
+
+    // Move the cell to the next phase once it has been in the phase for its full duration,
+    // a cell past the last phase wraps back to g1 and is flagged for division
+    uint flags = 0u;
+    if (progress >= durationSeconds[phase]) {
+        phase += 1u;
+        progress = 0.0;
+        if (phase >= 7u) {
+            phase = 0u;
+            flags = DIVIDED;
+        }
+    }
+
+    // Each cell dies with a chance set by the hazard of its phase, scaled by the crowding and its speed multiplier
+    float deathChance = deathHazardPerSecond[phase] * speedMultiplier * crowding * deltaSeconds;
+    if (Uniform(record.xy, stepIndex, DEATH_STREAM).x < deathChance) {
+        flags |= DIED | EMPTY;
+    }
+
+    // Update the position based on the velocity, a cell that went past a wall bounces off it
+    vec2 velocity = motion.zw;
+    vec2 position = Fold(motion.xy + velocity * deltaSeconds, velocity);
+
+    nextMotion = vec4(position, velocity);
+    nextCycle = uvec4(floatBitsToUint(progress), cycle.y, phase, flags);
+    nextRecord = record;
+}
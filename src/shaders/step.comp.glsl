@@ -0,0 +1,89 @@
+// Joined after philox.comp.glsl
+
+// Step every cell in place, and count the cells each one leaves in the next state:
+// itself unless it dies, and a daughter if it finished its cycle
+layout (local_size_x = GROUP_SIZE) in;
+
+layout (std430, binding = 0) buffer State {
+    Cell cells[];
+};
+
+// Bit 0 set if the cell divides, bit 1 if it dies and bit 2 if its daughter dies in the step it is made in
+layout (std430, binding = 2) writeonly buffer Flags {
+    uint flags[];
+};
+
+// Cells left by each cell, then daughters of each cell, scanned into offsets afterwards
+layout (std430, binding = 3) writeonly buffer Counts {
+    uvec2 counts[];
+};
+
+uniform uint stepIndex;
+uniform float deltaSeconds;
+
+// Fraction of the dish each cell covers, the death hazards are scaled by the fraction all of them cover
+uniform float crowdingPerCell;
+
+// Per-phase tables
+uniform float durationSeconds[7];
+uniform float deathHazardPerSecond[7];
+
+// Fold a position that went past the walls back into [-1, 1], as if it bounced off them, like
+// SimdKernels::Fold. The velocity is flipped on the folds that send the cell back the other way
+vec2 Fold(vec2 position, inout vec2 velocity) {
+    vec2 shifted = position + 1.0;
+    vec2 wrapped = shifted - 4.0 * floor(shifted * 0.25);
+    velocity = mix(velocity, -velocity, greaterThan(wrapped, vec2(2.0)));
+    return 1.0 - abs(wrapped - 2.0);
+}
+
+void main() {
+    uint i = CellIndex();
+    if (i >= cellCount) {
+        return;
+    }
+    Cell cell = cells[i];
+
+    // Update the progress in the phase
+    uint phase = cell.phase;
+    float progress = cell.phaseProgress + cell.speedMultiplier * deltaSeconds;
+
+    // Move the cell to the next phase once it has been in the phase for its full duration,
+    // a cell past the last phase wraps back to g1 and divides
+    bool divides = false;
+    if (progress >= durationSeconds[phase]) {
+        phase += 1u;
+        progress = 0.0;
+        if (phase >= 7u) {
+            phase = 0u;
+            divides = true;
+        }
+    }
+    cell.phase = phase;
+    cell.phaseProgress = progress;
+
+    // Each cell dies with a chance set by the hazard of its phase, scaled by the crowding and its speed multiplier
+    float crowding = float(cellCount) * crowdingPerCell;
+    float deathChance = deathHazardPerSecond[phase] * cell.speedMultiplier * crowding * deltaSeconds;
+    bool dies = Uniform(cell.id, stepIndex, DEATH_STREAM).x < deathChance;
+
+    // A daughter starts in G1 and rolls for death in the step it is made in, like every other cell. Its ID
+    // is only known once the daughters are counted, so it rolls on the third of the division numbers of
+    // its parent, the first two set the speed multipliers
+    bool daughterDies = false;
+    if (divides) {
+        vec4 randomNumbers = Uniform(cell.id, stepIndex, DIVISION_STREAM);
+        float daughterSpeedMultiplier = cell.speedMultiplier * (1.0 + (randomNumbers.x * 1.5 - 0.5) * 0.5);
+        daughterDies = randomNumbers.z < deathHazardPerSecond[phase] * daughterSpeedMultiplier * crowding * deltaSeconds;
+    }
+    bool born = divides && !daughterDies;
+
+    // Update the position based on the velocity, a cell that went past a wall bounces off it
+    vec2 velocity = cell.motion.zw;
+    vec2 position = Fold(cell.motion.xy + velocity * deltaSeconds, velocity);
+    cell.motion = vec4(position, velocity);
+
+    cells[i] = cell;
+    flags[i] = uint(divides) | (uint(dies) << 1) | (uint(daughterDies) << 2);
+    counts[i] = uvec2(uint(!dies) + uint(born), uint(born));
+}
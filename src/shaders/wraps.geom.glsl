@@ -0,0 +1,29 @@
+#version 330 core
+
+// Emit a point for each cell that finished its cycle or died in the last step and drop the
+// others, so transform feedback packs the cells that divide or die at the front of the event buffer
+layout (points) in;
+layout (points, max_vertices = 1) out;
+
+in vec4 Motion[];
+flat in uvec4 Cycle[];
+flat in uvec4 Record[];
+flat in int Index[];
+
+// Index and state of the cell, captured by transform feedback
+flat out uint wrapIndex;
+out vec4 wrapMotion;
+flat out uvec4 wrapCycle;
+flat out uvec4 wrapRecord;
+
+void main() {
+    // Bit 0 of the flags is set for a cell that finished its cycle, bit 1 for a cell that died
+    if ((Cycle[0].w & 3u) != 0u) {
+        wrapIndex = uint(Index[0]);
+        wrapMotion = Motion[0];
+        wrapCycle = Cycle[0];
+        wrapRecord = Record[0];
+        EmitVertex();
+        EndPrimitive();
+    }
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+// State of one cell, laid out as a CellInstance
+layout (location = 0) in vec4 motion;
+layout (location = 1) in uvec4 cycle;
+layout (location = 2) in uvec4 record;
+
+out vec4 Motion;
+flat out uvec4 Cycle;
+flat out uvec4 Record;
+flat out int Index;
+
+void main() {
+    Motion = motion;
+    Cycle = cycle;
+    Record = record;
+    Index = gl_VertexID;
+}
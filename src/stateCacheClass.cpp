@@ -0,0 +1,67 @@
+#include "headers/openGLdebug.hpp"
+#include "headers/stateCacheClass.hpp"
+
+// No state is known until it is first set
+GLuint StateCache::program = 0;
+GLenum StateCache::activeUnit = CACHED_TEXTURE_UNITS;
+GLuint StateCache::textures[CACHED_TEXTURE_UNITS] = {};
+GLenum StateCache::targets[CACHED_TEXTURE_UNITS] = {};
+
+void StateCache::UseProgram(GLuint program) {
+    if (program == StateCache::program) {
+        return;
+    }
+    GLCALL(glUseProgram(program));
+    StateCache::program = program;
+}
+
+// Make a texture unit active, unit is an offset from GL_TEXTURE0
+void StateCache::ActiveTexture(GLenum unit) {
+    if (unit == StateCache::activeUnit) {
+        return;
+    }
+    GLCALL(glActiveTexture(GL_TEXTURE0 + unit));
+    StateCache::activeUnit = unit;
+}
+
+// Bind a texture to a unit, unit is an offset from GL_TEXTURE0. The unit is only made
+// active when the bind reaches GL, so calls that change the bound texture need ActiveTexture
+void StateCache::BindTexture(GLenum unit, GLenum target, GLuint texture) {
+    if (unit < CACHED_TEXTURE_UNITS && StateCache::textures[unit] == texture && StateCache::targets[unit] == target) {
+        return;
+    }
+
+    StateCache::ActiveTexture(unit);
+    GLCALL(glBindTexture(target, texture));
+
+    if (unit < CACHED_TEXTURE_UNITS) {
+        StateCache::textures[unit] = texture;
+        StateCache::targets[unit] = target;
+    }
+}
+
+// Drop a program that is about to be deleted, GL could give its name to a new one
+void StateCache::ForgetProgram(GLuint program) {
+    if (program == StateCache::program) {
+        StateCache::program = 0;
+    }
+}
+
+// Drop a texture that is about to be deleted, GL could give its name to a new one
+void StateCache::ForgetTexture(GLuint texture) {
+    for (unsigned int unit = 0; unit < CACHED_TEXTURE_UNITS; ++unit) {
+        if (StateCache::textures[unit] == texture) {
+            StateCache::textures[unit] = 0;
+            StateCache::targets[unit] = 0;
+        }
+    }
+}
+
+void StateCache::Reset() {
+    StateCache::program = 0;
+    StateCache::activeUnit = CACHED_TEXTURE_UNITS;
+    for (unsigned int unit = 0; unit < CACHED_TEXTURE_UNITS; ++unit) {
+        StateCache::textures[unit] = 0;
+        StateCache::targets[unit] = 0;
+    }
+}
@@ -0,0 +1,151 @@
+#include "headers/openGLdebug.hpp"
+#include "headers/streamBufferClass.hpp"
+#include "../include/GLFW/glfw3.h"
+#include <algorithm>
+#include <cstring>
+
+// Size of each region before the first growth
+const static GLsizeiptr INITIAL_REGION_SIZE = 4096;
+
+// Check whether the context lists an extension
+static bool HasExtension(const char* name) {
+    GLint count = 0;
+    GLCALL(glGetIntegerv(GL_NUM_EXTENSIONS, &count));
+    for (GLint i = 0; i < count; ++i) {
+        const char* extension;
+        GLCALL(extension = (const char*)glGetStringi(GL_EXTENSIONS, i));
+        if (std::strcmp(extension, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Check whether buffers can be given storage that stays mapped while the GPU reads it
+static bool HasBufferStorage() {
+
+    // glad only loads the core functions, the extension uses the same entry point as GL 4.4
+    if (!glBufferStorage && HasExtension("GL_ARB_buffer_storage")) {
+        glad_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)glfwGetProcAddress("glBufferStorage");
+    }
+    return glBufferStorage != nullptr;
+}
+
+void StreamBuffer::Allocate(GLsizeiptr regionSize) {
+    this->Delete();
+    this->regionSize = regionSize;
+    this->generation += 1;
+
+    GLCALL(glGenBuffers(1, &this->ID));
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, this->ID));
+
+    if (this->persistent) {
+        // Coherent mapping, so writes are seen by the GPU without flushing
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLCALL(glBufferStorage(GL_ARRAY_BUFFER, STREAM_REGIONS * regionSize, nullptr, flags));
+        GLCALL(this->mapped = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, STREAM_REGIONS * regionSize, flags));
+    } else {
+        GLCALL(glBufferData(GL_ARRAY_BUFFER, regionSize, nullptr, GL_STREAM_DRAW));
+    }
+
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void StreamBuffer::Delete() {
+    for (GLsync& fence : this->fences) {
+        if (fence) {
+            GLCALL(glDeleteSync(fence));
+            fence = 0;
+        }
+    }
+
+    if (this->mapped) {
+        GLCALL(glBindBuffer(GL_ARRAY_BUFFER, this->ID));
+        GLCALL(glUnmapBuffer(GL_ARRAY_BUFFER));
+        GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        this->mapped = nullptr;
+    }
+
+    // The driver keeps the storage alive until the GPU has finished drawing from it
+    if (this->ID) {
+        GLCALL(glDeleteBuffers(1, &this->ID));
+        this->ID = 0;
+    }
+    this->region = 0;
+}
+
+// Get memory to write size bytes of new data to. The buffer is replaced by
+// a larger one if it is too small, so the buffer name can change on any call
+void* StreamBuffer::Map(GLsizeiptr size) {
+    if (size > this->regionSize) {
+        this->Allocate(std::max(size, 2 * this->regionSize));
+    }
+
+    if (this->persistent) {
+        // Wait for the GPU to finish the draws that read the next region
+        this->region = (this->region + 1) % STREAM_REGIONS;
+        GLsync& fence = this->fences[this->region];
+        if (fence) {
+            GLenum result;
+            do {
+                GLCALL(result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000));
+            } while (result == GL_TIMEOUT_EXPIRED);
+            GLCALL(glDeleteSync(fence));
+            fence = 0;
+        }
+        return this->mapped + this->region * this->regionSize;
+    }
+
+    // Orphan the old storage so the driver hands out new memory instead of waiting for the GPU
+    void* pointer;
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, this->ID));
+    GLCALL(glBufferData(GL_ARRAY_BUFFER, this->regionSize, nullptr, GL_STREAM_DRAW));
+    GLCALL(pointer = glMapBufferRange(GL_ARRAY_BUFFER, 0, std::max<GLsizeiptr>(size, 1), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    return pointer;
+}
+
+// Finish writing the new data, returns the offset in the buffer the data starts at
+GLintptr StreamBuffer::Unmap() {
+    if (this->persistent) {
+        return this->region * this->regionSize;
+    }
+
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, this->ID));
+    GLCALL(glUnmapBuffer(GL_ARRAY_BUFFER));
+    GLCALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    return 0;
+}
+
+// Mark the end of the draws that read the data written last. The data can be drawn
+// on several frames, each call moves the fence of its region to the latest draw
+void StreamBuffer::Fence() {
+    if (this->persistent) {
+        GLsync& fence = this->fences[this->region];
+        if (fence) {
+            GLCALL(glDeleteSync(fence));
+        }
+        GLCALL(fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    }
+}
+
+GLuint StreamBuffer::Buffer() const {
+    return this->ID;
+}
+
+// Changes each time the buffer is replaced, anything made from the old buffer has to be made again
+unsigned int StreamBuffer::Generation() const {
+    return this->generation;
+}
+
+bool StreamBuffer::Persistent() const {
+    return this->persistent;
+}
+
+StreamBuffer::StreamBuffer() : ID(0), persistent(HasBufferStorage()), regionSize(0), region(0), fences(), mapped(nullptr), generation(0) {
+    this->Allocate(INITIAL_REGION_SIZE);
+}
+
+StreamBuffer::~StreamBuffer() {
+    this->Delete();
+}